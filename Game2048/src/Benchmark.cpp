@@ -0,0 +1,395 @@
+#include "Benchmark.h"
+#include "Board.h"
+#include "MctsPolicy.h"
+#include "NTupleNetwork.h"
+#include "PackedBoard.h"
+#include "Policy.h"
+#include "Simulator.h"
+#include "TdTrainer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <span>
+#include <vector>
+
+namespace
+{
+	constexpr int BENCHMARK_WIN_VALUE = 2048;
+	constexpr int BENCHMARK_BOARD_HEIGHT = 5;
+	constexpr int BENCHMARK_BOARD_WIDTH = 4;
+	constexpr std::uint64_t BENCHMARK_SEED = 2048;
+	constexpr int BENCHMARK_OPENING_MOVES = 60;
+	constexpr std::chrono::milliseconds BENCHMARK_DECISION_BUDGET { 500 };
+	constexpr size_t BENCHMARK_TRAINING_GAMES = 4000;
+	constexpr size_t BENCHMARK_EVALUATION_GAMES = 200;
+	constexpr size_t BENCHMARK_EVALUATIONS_PER_VARIANT = 4'000'000;
+	constexpr size_t BENCHMARK_INCREMENTAL_PASSES = 3;
+	constexpr size_t BENCHMARK_BATCH_SIZE = 64;		// Leaves of one search expansion
+	constexpr size_t BENCHMARK_SIMULATION_GAMES = 200'000;
+
+	// Reproducible mid-game position, so every run measures the same tree shapes
+	Board makeBenchmarkPosition()
+	{
+		Board board(BENCHMARK_WIN_VALUE, BENCHMARK_BOARD_HEIGHT, BENCHMARK_BOARD_WIDTH);
+		std::mt19937_64 generator(BENCHMARK_SEED);
+		for (int move = 0; move < BENCHMARK_OPENING_MOVES; ++move)
+		{
+			for (const char direction : { 'a', 's', 'd', 'w' })
+			{
+				if (board.slide(direction))
+				{
+					board.spawnTile(generator());
+					break;
+				}
+			}
+		}
+		return board;
+	}
+
+	struct StrengthResult
+	{
+		double meanScore = 0.0;
+		double winRate = 0.0;
+	};
+
+	// Greedy games on a fixed spawn sequence, so every evaluator faces the same games
+	StrengthResult measureStrength(const PositionEvaluator& evaluator, size_t games, std::vector<Board>* positions)
+	{
+		const Board empty = Board::makeEmpty(BENCHMARK_WIN_VALUE, BENCHMARK_BOARD_HEIGHT, BENCHMARK_BOARD_WIDTH);
+
+		std::mt19937_64 generator(BENCHMARK_SEED);
+		NTuplePolicy policy(evaluator);
+		Board board = empty;
+		StrengthResult result;
+		for (size_t game = 0; game < games; ++game)
+		{
+			board = empty;
+			board.spawnTile(generator());
+			board.spawnTile(generator());
+			for (char direction = policy.chooseMove(board); direction != 0; direction = policy.chooseMove(board))
+			{
+				if (positions) { positions->push_back(board); }
+				board.slide(direction);
+				board.spawnTile(generator());
+			}
+			result.meanScore += board.getScore();
+			result.winRate += board.reachedVictoryValue();
+		}
+		result.meanScore /= static_cast<double>(games);
+		result.winRate /= static_cast<double>(games);
+		return result;
+	}
+
+	enum class PositionChange
+	{
+		Move,		// Afterstates of every legal move: whole lines change
+		Spawn		// Every spawn into an afterstate: one cell changes
+	};
+
+	// Values the successors of every position either from scratch or from the
+	// contributions of their common parent
+	double measureSuccessorEvaluationRate(const NTupleNetwork& network, const std::vector<Board>& boards,
+		PositionChange change, bool isIncremental)
+	{
+		NTupleContributions parent;
+		Board successor = boards.front();
+		float checksum = 0.0f;
+		size_t evaluations = 0;
+
+		const auto start = std::chrono::steady_clock::now();
+		for (size_t pass = 0; pass < BENCHMARK_INCREMENTAL_PASSES; ++pass)
+		{
+			for (const Board& board : boards)
+			{
+				if (change == PositionChange::Move)
+				{
+					if (isIncremental) { network.collectContributions(packBoard(board), parent); }
+					for (const char direction : { 'w', 'a', 's', 'd' })
+					{
+						successor = board;
+						if (!successor.slide(direction)) { continue; }
+
+						const PackedBoard packed = packBoard(successor);
+						checksum += isIncremental ? network.evaluateChanged(packed, parent, successor.getChangedCells()) : network.evaluate(packed);
+						++evaluations;
+					}
+					continue;
+				}
+
+				const PackedBoard afterstate = packBoard(board);
+				if (isIncremental) { network.collectContributions(afterstate, parent); }
+				for (size_t cell = 0; cell < board.getBoardHeight() * board.getBoardWidth(); ++cell)
+				{
+					if (afterstate.getExponent(cell) != 0) { continue; }
+					for (const int exponent : { 1, 2 })
+					{
+						PackedBoard spawned = afterstate;
+						spawned.setExponent(cell, exponent);
+						checksum += isIncremental ? network.evaluateChanged(spawned, parent, std::uint64_t{ 1 } << cell) : network.evaluate(spawned);
+						++evaluations;
+					}
+				}
+			}
+		}
+		const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+		volatile float sink = checksum;
+		static_cast<void>(sink);
+		return static_cast<double>(evaluations) / elapsed.count();
+	}
+
+	double measureEvaluationRate(const PositionEvaluator& evaluator, const std::vector<PackedBoard>& positions)
+	{
+		float checksum = 0.0f;
+		const auto start = std::chrono::steady_clock::now();
+		for (size_t k = 0; k < BENCHMARK_EVALUATIONS_PER_VARIANT; ++k)
+		{
+			checksum += evaluator.evaluate(positions[k % positions.size()]);
+		}
+		const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+		// Keeps the loop from being optimised away
+		volatile float sink = checksum;
+		static_cast<void>(sink);
+		return static_cast<double>(BENCHMARK_EVALUATIONS_PER_VARIANT) / elapsed.count();
+	}
+
+	// Consecutive positions go in one batch, the way a search hands over the leaves it expanded
+	double measureBatchEvaluationRate(const PositionEvaluator& evaluator, const std::vector<PackedBoard>& positions)
+	{
+		const size_t k_batches = positions.size() / BENCHMARK_BATCH_SIZE;
+		std::vector<float> values(BENCHMARK_BATCH_SIZE);
+		float checksum = 0.0f;
+		size_t evaluations = 0;
+		const auto start = std::chrono::steady_clock::now();
+		for (size_t batch = 0; evaluations < BENCHMARK_EVALUATIONS_PER_VARIANT; ++batch, evaluations += BENCHMARK_BATCH_SIZE)
+		{
+			const auto k_boards = std::span<const PackedBoard>(positions).subspan((batch % k_batches) * BENCHMARK_BATCH_SIZE, BENCHMARK_BATCH_SIZE);
+			evaluator.evaluateBatch(k_boards, values);
+			checksum += values.front();
+		}
+		const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+		volatile float sink = checksum;
+		static_cast<void>(sink);
+		return static_cast<double>(evaluations) / elapsed.count();
+	}
+}
+
+void runMctsScalingBenchmark(std::ostream& output, size_t maxThreads)
+{
+	const Board position = makeBenchmarkPosition();
+
+	output << std::left << std::setw(8) << "mode" << std::setw(10) << "threads"
+		<< std::setw(16) << "playouts/s" << "speedup\n";
+	for (const MctsParallelism parallelism : { MctsParallelism::Tree, MctsParallelism::Root })
+	{
+		double singleThreadRate = 0.0;
+		for (size_t threads = 1; threads <= maxThreads; threads *= 2)
+		{
+			MctsSettings settings;
+			settings.budget = BENCHMARK_DECISION_BUDGET;
+			settings.threadCount = threads;
+			settings.parallelism = parallelism;
+			settings.seed = BENCHMARK_SEED;
+
+			MctsPolicy policy(settings);
+			const auto start = std::chrono::steady_clock::now();
+			policy.chooseMove(position);
+			const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+			const double rate = static_cast<double>(policy.getIterations()) / elapsed.count();
+			if (threads == 1) { singleThreadRate = rate; }
+
+			output << std::setw(8) << (parallelism == MctsParallelism::Tree ? "tree" : "root")
+				<< std::setw(10) << threads
+				<< std::setw(16) << static_cast<long long>(rate)
+				<< std::fixed << std::setprecision(2) << rate / singleThreadRate << '\n';
+			output.unsetf(std::ios::fixed);
+		}
+	}
+}
+
+void runTrainingScalingBenchmark(std::ostream& output, size_t maxThreads)
+{
+	output << std::left << std::setw(10) << "threads" << std::setw(12) << "games/s"
+		<< std::setw(10) << "speedup" << std::setw(12) << "mean score" << "win rate\n";
+
+	double singleThreadRate = 0.0;
+	for (size_t threads = 1; threads <= maxThreads; threads *= 2)
+	{
+		NTupleNetwork network(BENCHMARK_BOARD_HEIGHT, BENCHMARK_BOARD_WIDTH,
+			NTupleNetwork::defaultTuples(BENCHMARK_BOARD_HEIGHT, BENCHMARK_BOARD_WIDTH));
+		TdTrainingSettings settings;
+		settings.evaluationInterval = 0;
+		settings.threadCount = threads;
+		settings.seed = BENCHMARK_SEED;
+
+		TdTrainer trainer(network, settings);
+		const auto start = std::chrono::steady_clock::now();
+		trainer.train(BENCHMARK_TRAINING_GAMES, output);
+		const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+		const TrainingEvaluation strength = trainer.evaluate(BENCHMARK_EVALUATION_GAMES);
+
+		const double rate = static_cast<double>(BENCHMARK_TRAINING_GAMES) / elapsed.count();
+		if (threads == 1) { singleThreadRate = rate; }
+
+		output << std::setw(10) << threads
+			<< std::setw(12) << static_cast<long long>(rate)
+			<< std::fixed << std::setprecision(2) << std::setw(10) << rate / singleThreadRate
+			<< std::setw(12) << static_cast<long long>(strength.meanScore)
+			<< 100.0 * strength.winRate << "%\n";
+		output.unsetf(std::ios::fixed);
+	}
+}
+
+void runQuantizationBenchmark(std::ostream& output, size_t trainingThreads)
+{
+	NTupleNetwork network(BENCHMARK_BOARD_HEIGHT, BENCHMARK_BOARD_WIDTH,
+		NTupleNetwork::defaultTuples(BENCHMARK_BOARD_HEIGHT, BENCHMARK_BOARD_WIDTH));
+	TdTrainingSettings settings;
+	settings.evaluationInterval = 0;
+	settings.threadCount = trainingThreads;
+	settings.seed = BENCHMARK_SEED;
+	TdTrainer(network, settings).train(BENCHMARK_TRAINING_GAMES, output);
+
+	const Int16NTupleNetwork int16Network(network);
+	const Int8NTupleNetwork int8Network(network);
+	const struct
+	{
+		const char* name;
+		const PositionEvaluator& evaluator;
+		size_t weightBytes;
+	} variants[] = {
+		{ "float", network, network.getWeightCount() * sizeof(float) },
+		{ "int16", int16Network, int16Network.getWeightCount() * sizeof(std::int16_t) },
+		{ "int8", int8Network, int8Network.getWeightCount() * sizeof(std::int8_t) }
+	};
+
+	output << std::left << std::setw(8) << "weights" << std::setw(10) << "MiB" << std::setw(14) << "evals/s"
+		<< std::setw(10) << "speedup" << std::setw(12) << "mean score" << "win rate\n";
+
+	std::vector<Board> boards;
+	std::vector<PackedBoard> positions;
+	double floatRate = 0.0;
+	for (const auto& variant : variants)
+	{
+		const StrengthResult strength = measureStrength(variant.evaluator, BENCHMARK_EVALUATION_GAMES, boards.empty() ? &boards : nullptr);
+		if (positions.empty())
+		{
+			for (const Board& board : boards) { positions.push_back(packBoard(board)); }
+		}
+		const double rate = measureEvaluationRate(variant.evaluator, positions);
+		if (floatRate == 0.0) { floatRate = rate; }
+
+		output << std::setw(8) << variant.name
+			<< std::setw(10) << variant.weightBytes / (1024 * 1024)
+			<< std::setw(14) << static_cast<long long>(rate)
+			<< std::fixed << std::setprecision(2) << std::setw(10) << rate / floatRate
+			<< std::setw(12) << static_cast<long long>(strength.meanScore)
+			<< 100.0 * strength.winRate << "%\n";
+		output.unsetf(std::ios::fixed);
+	}
+}
+
+void runIncrementalEvaluationBenchmark(std::ostream& output, size_t trainingThreads)
+{
+	NTupleNetwork network(BENCHMARK_BOARD_HEIGHT, BENCHMARK_BOARD_WIDTH,
+		NTupleNetwork::defaultTuples(BENCHMARK_BOARD_HEIGHT, BENCHMARK_BOARD_WIDTH));
+	TdTrainingSettings settings;
+	settings.evaluationInterval = 0;
+	settings.threadCount = trainingThreads;
+	settings.seed = BENCHMARK_SEED;
+	TdTrainer(network, settings).train(BENCHMARK_TRAINING_GAMES, output);
+
+	std::vector<Board> boards;
+	measureStrength(network, BENCHMARK_EVALUATION_GAMES, &boards);
+
+	output << std::left << std::setw(10) << "change" << std::setw(16) << "full evals/s"
+		<< std::setw(22) << "incremental evals/s" << "speedup\n";
+	for (const PositionChange change : { PositionChange::Move, PositionChange::Spawn })
+	{
+		const double fullRate = measureSuccessorEvaluationRate(network, boards, change, false);
+		const double incrementalRate = measureSuccessorEvaluationRate(network, boards, change, true);
+		output << std::setw(10) << (change == PositionChange::Move ? "move" : "spawn")
+			<< std::setw(16) << static_cast<long long>(fullRate)
+			<< std::setw(22) << static_cast<long long>(incrementalRate)
+			<< std::fixed << std::setprecision(2) << incrementalRate / fullRate << '\n';
+		output.unsetf(std::ios::fixed);
+	}
+}
+
+void runBatchEvaluationBenchmark(std::ostream& output, size_t trainingThreads)
+{
+	NTupleNetwork network(BENCHMARK_BOARD_HEIGHT, BENCHMARK_BOARD_WIDTH,
+		NTupleNetwork::defaultTuples(BENCHMARK_BOARD_HEIGHT, BENCHMARK_BOARD_WIDTH));
+	TdTrainingSettings settings;
+	settings.evaluationInterval = 0;
+	settings.threadCount = trainingThreads;
+	settings.seed = BENCHMARK_SEED;
+	TdTrainer(network, settings).train(BENCHMARK_TRAINING_GAMES, output);
+
+	const Int16NTupleNetwork int16Network(network);
+	const Int8NTupleNetwork int8Network(network);
+	const struct
+	{
+		const char* name;
+		const PositionEvaluator& evaluator;
+	} variants[] = { { "float", network }, { "int16", int16Network }, { "int8", int8Network } };
+
+	std::vector<Board> boards;
+	measureStrength(network, BENCHMARK_EVALUATION_GAMES, &boards);
+	std::vector<PackedBoard> positions;
+	for (const Board& board : boards) { positions.push_back(packBoard(board)); }
+
+	output << std::left << std::setw(8) << "weights" << std::setw(16) << "single evals/s"
+		<< std::setw(16) << "batch evals/s" << "speedup\n";
+	for (const auto& variant : variants)
+	{
+		const double singleRate = measureEvaluationRate(variant.evaluator, positions);
+		const double batchRate = measureBatchEvaluationRate(variant.evaluator, positions);
+		output << std::setw(8) << variant.name
+			<< std::setw(16) << static_cast<long long>(singleRate)
+			<< std::setw(16) << static_cast<long long>(batchRate)
+			<< std::fixed << std::setprecision(2) << batchRate / singleRate << '\n';
+		output.unsetf(std::ios::fixed);
+	}
+}
+
+void runSimulationScalingBenchmark(std::ostream& output, size_t maxThreads)
+{
+	SimulationSettings settings;
+	settings.games = BENCHMARK_SIMULATION_GAMES;
+	settings.boardHeight = BENCHMARK_BOARD_HEIGHT;
+	settings.boardWidth = BENCHMARK_BOARD_WIDTH;
+	settings.winValue = BENCHMARK_WIN_VALUE;
+	settings.seed = BENCHMARK_SEED;
+	const PolicyFactory makePolicy = [](std::uint64_t seed) { return std::make_unique<RandomPolicy>(seed); };
+
+	output << std::left << std::setw(10) << "threads" << std::setw(14) << "moves/s" << std::setw(12) << "games/s"
+		<< std::setw(10) << "speedup" << std::setw(12) << "efficiency" << "max idle ms\n";
+
+	double singleThreadRate = 0.0;
+	for (size_t threads = 1; threads <= maxThreads; threads *= 2)
+	{
+		settings.threadCount = threads;
+		Simulator simulator(settings, makePolicy);
+		const SimulationResult result = simulator.run();
+		double maxIdleSeconds = 0.0;
+		for (const SimulationWorkerReport& report : simulator.getWorkerReports()) { maxIdleSeconds = std::max(maxIdleSeconds, report.idleSeconds); }
+		if (threads == 1) { singleThreadRate = result.movesPerSecond(); }
+
+		const double speedup = result.movesPerSecond() / singleThreadRate;
+		output << std::setw(10) << threads
+			<< std::setw(14) << static_cast<long long>(result.movesPerSecond())
+			<< std::setw(12) << static_cast<long long>(result.gamesPerSecond())
+			<< std::fixed << std::setprecision(2) << std::setw(10) << speedup
+			<< std::setw(12) << 100.0 * speedup / static_cast<double>(threads)
+			<< 1000.0 * maxIdleSeconds << '\n';
+		output.unsetf(std::ios::fixed);
+	}
+}
@@ -0,0 +1,24 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <iosfwd>
+
+// Playouts per second of both parallel tree search modes for 1, 2, 4, ... maxThreads threads
+void runMctsScalingBenchmark(std::ostream& output, size_t maxThreads);
+
+// Hogwild training throughput and the strength it reaches in a fixed number of games, per thread count
+void runTrainingScalingBenchmark(std::ostream& output, size_t maxThreads);
+
+// Evaluation speed and playing strength of a trained network with float, int16 and int8 weights
+void runQuantizationBenchmark(std::ostream& output, size_t trainingThreads);
+
+// Full against incremental evaluation of successors that differ from their parent by a move or by a spawn
+void runIncrementalEvaluationBenchmark(std::ostream& output, size_t trainingThreads);
+
+// One position at a time against batches of positions evaluated together, per weight type
+void runBatchEvaluationBenchmark(std::ostream& output, size_t trainingThreads);
+
+// Random-policy simulation throughput for 1, 2, 4, ... maxThreads pinned worker threads
+void runSimulationScalingBenchmark(std::ostream& output, size_t maxThreads);
+
+#endif // BENCHMARK_H
@@ -4,6 +4,7 @@
 #include <iostream>
 #include <iomanip>
 #include <cassert>
+#include <functional>
 #include <random>
 #include <string>
 
@@ -13,15 +14,16 @@ namespace
 	constexpr int DISTRIBUTION_MINIMUM_VALUE = 1;
 	constexpr int DISTRIBUTION_MAXIMUM_VALUE = 100;
 	constexpr int DISTRIBUTION_SMALLEST_TILE_TRESHOLD = 90;
+	constexpr size_t CHANGED_CELLS_CAPACITY = 64;
 
+	// Per thread, so that boards on different threads can move and reset concurrently
 #ifdef _DEBUG
-	std::mt19937 mt{};
+	thread_local std::mt19937 mt{};
 #else
-	std::random_device rd;
-	std::mt19937 mt{ rd() };
+	thread_local std::mt19937 mt{ std::random_device{}() };
 #endif
 
-	const std::uniform_int_distribution randomizer { DISTRIBUTION_MINIMUM_VALUE, DISTRIBUTION_MAXIMUM_VALUE };
+	thread_local std::uniform_int_distribution randomizer { DISTRIBUTION_MINIMUM_VALUE, DISTRIBUTION_MAXIMUM_VALUE };
 
 	constexpr auto tileContainsValue = [](int tile) -> bool
 	{
@@ -34,12 +36,13 @@ namespace
 	};
 }
 
-std::pair<bool, int> shiftToBegin(std::vector<int>& cache);
-std::pair<bool, int> shiftToEnd(std::vector<int>& cache);
+std::pair<bool, int> shiftToBegin(std::span<int> cache);
+std::pair<bool, int> shiftToEnd(std::span<int> cache);
 
 Board::Board(const int winValue, const int height, const int width) :
 	m_winningValue(winValue),
-	m_tiles { std::vector<std::vector<int>>(height, std::vector<int>(width, 0)) }
+	m_tiles { std::vector<std::vector<int>>(height, std::vector<int>(width, 0)) },
+	m_columnCache(height, 0)
 {
 	reset();
 }
@@ -47,16 +50,29 @@ Board::Board(const int winValue, const int height, const int width) :
 Board::Board(const Board& gameBoard) : 
 	m_winningValue(gameBoard.m_winningValue), 
 	m_tiles(gameBoard.m_tiles),
-	m_score(gameBoard.m_score)
+	m_columnCache(gameBoard.m_columnCache.size(), 0),
+	m_score(gameBoard.m_score),
+	m_changedCells(gameBoard.m_changedCells)
 {}
 
+// The constructor spawns tiles from the board's own generator; seeded games and replays start from nothing
+Board Board::makeEmpty(const int winValue, const int height, const int width)
+{
+	Board board(winValue, height, width);
+	board.clear();
+	return board;
+}
+
+// Assigning a board of the same size reuses the existing storage and never allocates
 Board& Board::operator=(const Board& gameBoard)
 {
 	if (this == &gameBoard) { return *this; }
 
 	assert(this->m_winningValue == gameBoard.m_winningValue && "Copy of boards with different winning values");
 	m_tiles = gameBoard.m_tiles;
+	m_columnCache.resize(gameBoard.m_columnCache.size());
 	m_score = gameBoard.m_score;
+	m_changedCells = gameBoard.m_changedCells;
 	return *this;
 }
 
@@ -82,6 +98,13 @@ void Board::reset()
 	addRandomTile();
 }
 
+void Board::clear()
+{
+	for (std::vector<int>& row : m_tiles) { std::fill(row.begin(), row.end(), 0); }
+	m_score = 0;
+	m_changedCells = 0;
+}
+
 void drawLine(const size_t width, std::ostream& display) 
 {
 	display << '\n';
@@ -158,6 +181,14 @@ bool Board::canMove() const
 
 bool Board::move(char direction) 
 {
+	const bool isContentMoved = slide(direction);
+	if (isContentMoved) { addRandomTile(); }
+	return isContentMoved;
+}
+
+bool Board::slide(char direction)
+{
+	m_changedCells = 0;
 	bool isContentMoved = false;
 	switch (direction)
 	{
@@ -174,16 +205,87 @@ bool Board::move(char direction)
 		isContentMoved = moveDown();
 		break;
 	}
-
-	if (isContentMoved) { addRandomTile(); }
 	return isContentMoved;
 }
 
+size_t Board::placeTile(size_t emptyTileIndex, int value)
+{
+	for (size_t i = 0; i < getBoardHeight(); ++i)
+	{
+		for (size_t j = 0; j < getBoardWidth(); ++j)
+		{
+			if (tileContainsValue(m_tiles[i][j])) { continue; }
+			if (emptyTileIndex-- == 0)
+			{
+				const size_t cell = i * getBoardWidth() + j;
+				m_tiles[i][j] = value;
+				m_changedCells |= (cell < CHANGED_CELLS_CAPACITY) ? std::uint64_t{ 1 } << cell : ~std::uint64_t{ 0 };
+				return cell;
+			}
+		}
+	}
+
+	assert(false && "Empty tile index is out of range");
+	return getBoardHeight() * getBoardWidth();
+}
+
+// Same spawn distribution as addRandomTile(), drawn from caller-supplied random bits
+// so that simulations can run their own generators; returns the cell index of the new tile
+size_t Board::spawnTile(std::uint64_t randomBits)
+{
+	const size_t k_availableTiles = getEmptyTilesCount();
+	if (k_availableTiles == 0) { return getBoardHeight() * getBoardWidth(); }
+
+	const auto k_distributionRange = static_cast<std::uint64_t>(DISTRIBUTION_MAXIMUM_VALUE - DISTRIBUTION_MINIMUM_VALUE + 1);
+	const auto roll = static_cast<int>(randomBits % k_distributionRange) + DISTRIBUTION_MINIMUM_VALUE;
+	const int value = GAME_MIN_TILE_VALUE + (roll > DISTRIBUTION_SMALLEST_TILE_TRESHOLD) * GAME_MIN_TILE_VALUE;
+	return placeTile(static_cast<size_t>((randomBits / k_distributionRange) % k_availableTiles), value);
+}
+
+size_t Board::getEmptyTilesCount() const
+{
+	size_t count = 0;
+	for (const auto& row : m_tiles)
+	{
+		count += std::count_if(row.begin(), row.end(), std::not_fn(tileContainsValue));
+	}
+	return count;
+}
+
+// Row-major bit per cell of every line the last slide moved and of the tiles placed since;
+// boards of more than 64 cells report every cell
+std::uint64_t Board::getChangedCells() const
+{
+	return m_changedCells;
+}
+
+int Board::getTile(size_t row, size_t column) const
+{
+	return m_tiles[row][column];
+}
+
+int Board::getMaxTile() const
+{
+	int maxTile = 0;
+	for (const std::vector<int>& row : m_tiles) { maxTile = std::max(maxTile, *std::max_element(row.begin(), row.end())); }
+	return maxTile;
+}
+
+void Board::setTile(size_t row, size_t column, int value)
+{
+	m_tiles[row][column] = value;
+}
+
 int Board::getScore() const
 {
 	return m_score;
 }
 
+void Board::setScore(int score)
+{
+	m_score = score;
+}
+
 size_t Board::getBoardWidth() const
 {
 	return m_tiles.front().size();
@@ -194,46 +296,26 @@ size_t Board::getBoardHeight() const
 	return m_tiles.size();
 }
 
-std::vector<Board::Coordinate_t> Board::getEmptyTilesCoordinates() const
-{
-	std::vector<Coordinate_t> points;
-	for (size_t i = 0; i < getBoardHeight(); ++i)
-	{
-		for (size_t j = 0; j < getBoardWidth(); ++j)
-		{
-			if (!tileContainsValue(m_tiles[i][j]))
-			{
-				points.emplace_back(Coordinate_t{ i, j });
-			}
-		}
-	}
-	return points;
-};
-
 void Board::addRandomTile() 
 {
-	const auto k_availableTiles = getEmptyTilesCoordinates();
-	if (k_availableTiles.empty()) { return; }
+	const size_t k_availableTiles = getEmptyTilesCount();
+	if (k_availableTiles == 0) { return; }
 
-	std::uniform_int_distribution<size_t> indexSelector{ size_t {0}, k_availableTiles.size() - 1 };
-	const auto [rowIndex, columnIndex] = k_availableTiles[indexSelector(mt)];
-	m_tiles[rowIndex][columnIndex] = getRandomTile();
+	std::uniform_int_distribution<size_t> indexSelector{ size_t {0}, k_availableTiles - 1 };
+	const size_t emptyTileIndex = indexSelector(mt);
+	placeTile(emptyTileIndex, getRandomTile());
 }
 
 bool Board::moveLeft() 
 {
 	bool isMoved = false;
 
-	std::vector<int> cache(getBoardWidth(), 0);
 	for (size_t i = 0; i < getBoardHeight(); ++i)
 	{
-		for (size_t j = 0; j < getBoardWidth(); ++j) { cache[j] = m_tiles[i][j]; }
-
-		const auto [moved, scored] = shiftToBegin(cache);
+		const auto [moved, scored] = shiftToBegin(m_tiles[i]);
 		isMoved |= moved;
 		m_score += scored;
-
-		for (size_t j = 0; j < getBoardWidth(); ++j) { m_tiles[i][j] = cache[j]; }
+		if (moved) { m_changedCells |= getRowCells(i); }
 	}
 	return isMoved;
 }
@@ -242,15 +324,12 @@ bool Board::moveRight()
 {
 	bool isMoved = false;
 
-	std::vector<int> cache(getBoardWidth(), 0);
 	for (size_t i = 0; i < getBoardHeight(); ++i)
 	{
-		for (size_t j = 0; j < getBoardWidth(); ++j) { cache[j] = m_tiles[i][j]; }
-		const auto [moved, scored] = shiftToEnd(cache);
+		const auto [moved, scored] = shiftToEnd(m_tiles[i]);
 		isMoved |= moved;
 		m_score += scored;
-
-		for (size_t j = 0; j < getBoardWidth(); ++j) { m_tiles[i][j] = cache[j]; }
+		if (moved) { m_changedCells |= getRowCells(i); }
 	}
 	return isMoved;
 }
@@ -259,7 +338,7 @@ bool Board::moveUp()
 {
 	bool isMoved = false;
 
-	std::vector<int> cache(getBoardHeight(), 0);
+	std::span<int> cache = m_columnCache;
 	for (size_t j = 0; j < getBoardWidth(); ++j)
 	{
 		for (size_t i = 0; i < getBoardHeight(); ++i) { cache[i] = m_tiles[i][j]; }
@@ -267,6 +346,7 @@ bool Board::moveUp()
 		const auto [moved, scored] = shiftToBegin(cache);
 		isMoved |= moved;
 		m_score += scored;
+		if (moved) { m_changedCells |= getColumnCells(j); }
 
 		for (size_t i = 0; i < getBoardHeight(); ++i) { m_tiles[i][j] = cache[i]; }
 	}
@@ -277,7 +357,7 @@ bool Board::moveDown()
 {
 	bool isMoved = false;
 
-	std::vector<int> cache(getBoardHeight(), 0);
+	std::span<int> cache = m_columnCache;
 	for (size_t j = 0; j < getBoardWidth(); ++j)
 	{
 		for (size_t i = 0; i < getBoardHeight(); ++i) { cache[i] = m_tiles[i][j]; }
@@ -285,12 +365,28 @@ bool Board::moveDown()
 		const auto [moved, scored] = shiftToEnd(cache);
 		isMoved |= moved;
 		m_score += scored;
+		if (moved) { m_changedCells |= getColumnCells(j); }
 
 		for (size_t i = 0; i < getBoardHeight(); ++i) { m_tiles[i][j] = cache[i]; }
 	}
 	return isMoved;
 }
 
+std::uint64_t Board::getRowCells(size_t row) const
+{
+	if (getBoardHeight() * getBoardWidth() > CHANGED_CELLS_CAPACITY) { return ~std::uint64_t{ 0 }; }
+	return (~std::uint64_t{ 0 } >> (CHANGED_CELLS_CAPACITY - getBoardWidth())) << (row * getBoardWidth());
+}
+
+std::uint64_t Board::getColumnCells(size_t column) const
+{
+	if (getBoardHeight() * getBoardWidth() > CHANGED_CELLS_CAPACITY) { return ~std::uint64_t{ 0 }; }
+
+	std::uint64_t cells = 0;
+	for (size_t i = 0; i < getBoardHeight(); ++i) { cells |= std::uint64_t{ 1 } << (i * getBoardWidth() + column); }
+	return cells;
+}
+
 bool Board::reachedVictoryValue() const 
 {
 	for (size_t i = 0; i < getBoardHeight(); i++) 
@@ -306,95 +402,50 @@ bool Board::reachedVictoryValue() const
 	return false;
 }
 
-std::pair<bool, int> shiftToBegin(std::vector<int>& cache)
+// Compacts the line towards begin and merges each equal pair once, in place
+template <typename Iterator>
+std::pair<bool, int> shiftLine(Iterator begin, Iterator end)
 {
-	const auto cahcedMatrixSlice = cache.data();
-	const auto columnSize = cache.size();
-
-	// Remove in between zeros
-	std::vector<int> result(columnSize, 0);
-	std::copy_if(cahcedMatrixSlice, cahcedMatrixSlice + columnSize, result.begin(), tileContainsValue);
-
-	// Accumulate from front
+	bool isMoved = false;
 	int scorePerShift = 0;
-	for (auto it = result.begin() + 1; it != result.end(); ++it)
+
+	auto target = begin;
+	bool canMergeIntoPrevious = false;
+	for (auto it = begin; it != end; ++it)
 	{
-		const auto prev = it - 1;
-		const auto next = it + 1;
-		if ((*prev == *it) && tileContainsValue(*it))
+		const int value = *it;
+		if (!tileContainsValue(value)) { continue; }
+
+		if (canMergeIntoPrevious && *(target - 1) == value)
 		{
-			*prev *= 2; *it = 0;
-			it += (next != result.end());
-			scorePerShift += *prev;
+			*(target - 1) *= 2;
+			*it = 0;
+			scorePerShift += *(target - 1);
+			canMergeIntoPrevious = false;
+			isMoved = true;
+			continue;
 		}
-	}
 
-	// Shift to back
-	for (auto it = result.begin() + 1; it != result.end(); ++it)
-	{
-		const auto prev = it - 1;
-		if (!tileContainsValue(*prev))
+		if (it != target)
 		{
-			auto nextNonZero = std::find_if(prev, result.end(), tileContainsValue);
-			if (nextNonZero == result.end()) { break; }
-
-			std::iter_swap(prev, nextNonZero);
+			*target = value;
+			*it = 0;
+			isMoved = true;
 		}
+		++target;
+		canMergeIntoPrevious = true;
 	}
-
-	// Save Calculate 
-	const bool isMoved = !std::equal(result.begin(), result.end(), cahcedMatrixSlice);
-
-	// Write back
-	std::fill(cahcedMatrixSlice, cahcedMatrixSlice + columnSize, 0);
-	std::copy(result.begin(), result.end(), cahcedMatrixSlice);
 	return { isMoved, scorePerShift };
 }
 
-std::pair<bool, int> shiftToEnd(std::vector<int>& cache)
+std::pair<bool, int> shiftToBegin(std::span<int> cache)
 {
-	const auto cahcedMatrixSlice = cache.data();
-	const auto columnSize = cache.size();
-
-	// removeEmptyCells(int* cahcedMatrixSlice, int columnSize) -> std::vector<int>
-	std::vector<int> result(columnSize, 0);
-	std::copy_if(cahcedMatrixSlice, cahcedMatrixSlice + columnSize, result.begin(), tileContainsValue);
-
-	// calcScore(begin, end) -> int
-	int scorePerShift = 0;
-	for (auto it = result.rbegin() + 1; it != result.rend(); ++it)
-	{
-		// mergeWithSame(auto currentIter, auto lastIter) -> int
-		const auto prev = it - 1;
-		const auto next = it + 1;
-		if ((*prev == *it) && tileContainsValue(*it))
-		{
-			*prev *= 2; *it = 0;
-			it += (next != result.rend());
-			scorePerShift += *prev;
-		}
-	}
-
-	// shiftToSide(auto begin, auto end) -> void
-	for (auto it = result.rbegin() + 1; it != result.rend(); ++it)
-	{
-		const auto prev = it - 1;
-		if (!tileContainsValue(*prev))
-		{
-			auto nextNonZero = std::find_if(prev, result.rend(), tileContainsValue);
-			if (nextNonZero == result.rend()) { break; }
-
-			std::iter_swap(prev, nextNonZero);
-		}
-	}
-
-	// 
-	const bool isMoved = !std::equal(result.begin(), result.end(), cahcedMatrixSlice);
+	return shiftLine(cache.begin(), cache.end());
+}
 
-	// copyRow Write back
-	std::fill(cahcedMatrixSlice, cahcedMatrixSlice + columnSize, 0);
-	std::copy(result.begin(), result.end(), cahcedMatrixSlice);
-	return { isMoved, scorePerShift };
+std::pair<bool, int> shiftToEnd(std::span<int> cache)
+{
+	return shiftLine(cache.rbegin(), cache.rend());
 }
 
 #ifdef _DEBUG
@@ -4,6 +4,7 @@
 #include <iosfwd>
 #include <vector>
 #include <array>
+#include <cstdint>
 #include <span>
 #include <tuple>
 
@@ -13,6 +14,7 @@ public:
 	Board(const int winValue, const int height, const int width);
 	Board(const Board& gameBoard);
 	Board& operator=(const Board& gameBoard);
+	static Board makeEmpty(const int winValue, const int height, const int width);		// No tiles and no score
 
 public:
 	void reset();
@@ -23,6 +25,20 @@ public:
 	bool reachedVictoryValue() const;
 	int getScore() const;
 
+public: // For solvers: moves without spawning and explicit tile placement
+	bool slide(char direction);
+	void clear();
+	size_t placeTile(size_t emptyTileIndex, int value);
+	size_t spawnTile(std::uint64_t randomBits);
+	size_t getEmptyTilesCount() const;
+	std::uint64_t getChangedCells() const;
+	int getTile(size_t row, size_t column) const;
+	int getMaxTile() const;
+	void setTile(size_t row, size_t column, int value);
+	void setScore(int score);
+	size_t getBoardWidth() const;
+	size_t getBoardHeight() const;
+
 #ifdef _DEBUG
 public: // For Google Tests
 	void setBoard(const std::span<int> data);
@@ -31,24 +47,22 @@ public: // For Google Tests
 #endif
 
 private:
-	using Coordinate_t = std::array<size_t, 2>;
-
-private:
-	std::vector<Coordinate_t> getEmptyTilesCoordinates() const;
-	size_t getBoardWidth() const;
-	size_t getBoardHeight() const;
 	void addRandomTile();
 	bool moveLeft();
 	bool moveRight();
 	bool moveUp();
 	bool moveDown();
+	std::uint64_t getRowCells(size_t row) const;
+	std::uint64_t getColumnCells(size_t column) const;
 
 private:
 	const int m_winningValue;
 
 private:
 	std::vector<std::vector<int>> m_tiles;
+	std::vector<int> m_columnCache;
 	int m_score = 0;
+	std::uint64_t m_changedCells = 0;
 };
 
 #endif // BOARD_H
@@ -0,0 +1,172 @@
+#include "Checkpoint.h"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <io.h>
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+	constexpr std::array<char, 8> CHECKPOINT_MAGIC = { '2', '0', '4', '8', 'C', 'K', 'P', '\0' };
+	constexpr std::uint32_t CHECKPOINT_VERSION = 2;
+	constexpr std::uint64_t CHECKPOINT_CHECKSUM_START = 0xcbf29ce484222325;
+
+	static_assert(sizeof(CheckpointFileHeader) == 32, "Checkpoint file header must have no padding");
+
+	// FNV-1a, continued from checksum over the next bytes of the payload
+	std::uint64_t updateChecksum(std::uint64_t checksum, const char* bytes, size_t size)
+	{
+		for (size_t k = 0; k < size; ++k) { checksum = (checksum ^ static_cast<unsigned char>(bytes[k])) * 0x100000001b3; }
+		return checksum;
+	}
+
+	// Writes the file's buffered data through to the disk
+	bool syncFile(std::FILE* file)
+	{
+		if (std::fflush(file) != 0) { return false; }
+#ifdef _WIN32
+		return FlushFileBuffers(reinterpret_cast<HANDLE>(_get_osfhandle(_fileno(file)))) != 0;
+#else
+		return fsync(fileno(file)) == 0;
+#endif
+	}
+
+	// Makes a rename within the directory durable; NTFS journals it with the rename itself
+	void syncDirectory(const std::filesystem::path& directory)
+	{
+#ifndef _WIN32
+		const int descriptor = open(directory.empty() ? "." : directory.c_str(), O_RDONLY);
+		if (descriptor < 0) { return; }
+		fsync(descriptor);
+		close(descriptor);
+#else
+		static_cast<void>(directory);
+#endif
+	}
+}
+
+// The header is a placeholder until commit(), which knows the payload's size and checksum
+CheckpointWriter::CheckpointWriter(const std::string& path, CheckpointKind kind) :
+	m_path(path),
+	m_temporaryPath(path + ".tmp"),
+	m_kind(kind),
+	m_file(std::fopen(m_temporaryPath.c_str(), "wb")),
+	m_checksum(CHECKPOINT_CHECKSUM_START)
+{
+	const CheckpointFileHeader k_placeholder;
+	m_isGood = m_file && std::fwrite(&k_placeholder, sizeof(k_placeholder), 1, m_file) == 1;
+}
+
+CheckpointWriter::~CheckpointWriter()
+{
+	if (!m_file) { return; }
+
+	std::fclose(m_file);
+	std::error_code error;
+	std::filesystem::remove(m_temporaryPath, error);
+}
+
+void CheckpointWriter::writeBytes(const void* data, size_t size)
+{
+	if (!m_isGood || size == 0) { return; }
+
+	const auto* bytes = static_cast<const char*>(data);
+	m_checksum = updateChecksum(m_checksum, bytes, size);
+	m_payloadSize += size;
+	m_isGood = std::fwrite(bytes, 1, size, m_file) == size;
+}
+
+void CheckpointWriter::writeString(const std::string& text)
+{
+	write(static_cast<std::uint64_t>(text.size()));
+	writeBytes(text.data(), text.size());
+}
+
+bool CheckpointWriter::commit()
+{
+	if (!m_file) { return false; }
+
+	CheckpointFileHeader header;
+	header.magic = CHECKPOINT_MAGIC;
+	header.version = CHECKPOINT_VERSION;
+	header.kind = m_kind;
+	header.payloadSize = m_payloadSize;
+	header.checksum = m_checksum;
+	m_isGood = m_isGood && std::fseek(m_file, 0, SEEK_SET) == 0
+		&& std::fwrite(&header, sizeof(header), 1, m_file) == 1 && syncFile(m_file);
+	m_isGood = (std::fclose(m_file) == 0) && m_isGood;
+	m_file = nullptr;
+
+	std::error_code error;
+	if (!m_isGood)
+	{
+		std::filesystem::remove(m_temporaryPath, error);
+		return false;
+	}
+	std::filesystem::rename(m_temporaryPath, m_path, error);
+	if (error) { return false; }
+
+	syncDirectory(std::filesystem::path(m_path).parent_path());
+	return true;
+}
+
+CheckpointReader::CheckpointReader(const std::string& path, CheckpointKind kind)
+{
+	std::ifstream file(path, std::ios::binary);
+	CheckpointFileHeader header;
+	if (!file.read(reinterpret_cast<char*>(&header), sizeof(header))) { return; }
+	if (header.magic != CHECKPOINT_MAGIC || header.version != CHECKPOINT_VERSION || header.kind != kind) { return; }
+
+	// The size is checked against the file before anything is allocated for it
+	const auto k_payloadStart = file.tellg();
+	file.seekg(0, std::ios::end);
+	if (static_cast<std::uint64_t>(file.tellg() - k_payloadStart) != header.payloadSize) { return; }
+	file.seekg(k_payloadStart);
+
+	m_payload.resize(static_cast<size_t>(header.payloadSize));
+	m_isOpen = file.read(m_payload.data(), static_cast<std::streamsize>(m_payload.size())) && updateChecksum(CHECKPOINT_CHECKSUM_START, m_payload.data(), m_payload.size()) == header.checksum;
+}
+
+bool CheckpointReader::readBytes(void* data, size_t size)
+{
+	if (!m_isOpen || size > m_payload.size() - m_offset) { return false; }
+
+	std::memcpy(data, m_payload.data() + m_offset, size);
+	m_offset += size;
+	return true;
+}
+
+bool CheckpointReader::readString(std::string& text)
+{
+	std::uint64_t size = 0;
+	if (!read(size) || size > m_payload.size() - m_offset) { return false; }
+
+	text.assign(m_payload.data() + m_offset, static_cast<size_t>(size));
+	m_offset += static_cast<size_t>(size);
+	return true;
+}
+
+bool CheckpointReader::isOpen() const
+{
+	return m_isOpen;
+}
+
+bool CheckpointReader::isAtEnd() const
+{
+	return m_offset == m_payload.size();
+}
+
+bool checkpointExists(const std::string& path)
+{
+	std::error_code error;
+	return std::filesystem::exists(path, error);
+}
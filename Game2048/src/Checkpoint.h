@@ -0,0 +1,94 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+enum class CheckpointKind : std::uint32_t
+{
+	Simulation = 1,
+	Training = 2
+};
+
+// Starts every checkpoint file; little-endian. The payload follows, laid out by
+// whoever wrote it, and the checksum covers all of it, so a torn or damaged file
+// is refused as a whole rather than half resumed.
+struct CheckpointFileHeader
+{
+	std::array<char, 8> magic {};
+	std::uint32_t version = 0;
+	CheckpointKind kind = CheckpointKind::Simulation;
+	std::uint64_t payloadSize = 0;
+	std::uint64_t checksum = 0;			// FNV-1a of the payload
+};
+
+// Streams a checkpoint to path.tmp, hashing the payload as it goes, so even the largest
+// weight tables are written without a copy. commit() fills in the header, syncs the file
+// to disk and only then renames it over path: the previous checkpoint stays whole until
+// the new one is complete and durable. An uncommitted writer removes its temporary file.
+class CheckpointWriter
+{
+public:
+	CheckpointWriter(const std::string& path, CheckpointKind kind);
+	CheckpointWriter(const CheckpointWriter&) = delete;
+	CheckpointWriter& operator=(const CheckpointWriter&) = delete;
+	~CheckpointWriter();
+
+public:
+	template <typename T>
+	void write(const T& value)
+	{
+		static_assert(std::is_trivially_copyable_v<T>, "Checkpoints hold plain values only");
+		writeBytes(&value, sizeof(value));
+	}
+
+	void writeBytes(const void* data, size_t size);
+	void writeString(const std::string& text);
+	bool commit();
+
+private:
+	const std::string m_path;
+	const std::string m_temporaryPath;
+	const CheckpointKind m_kind;
+
+private:
+	std::FILE* m_file = nullptr;
+	std::uint64_t m_payloadSize = 0;
+	std::uint64_t m_checksum = 0;
+	bool m_isGood = false;
+};
+
+// Loads a whole checkpoint and checks its header and checksum before anything is read
+class CheckpointReader
+{
+public:
+	CheckpointReader(const std::string& path, CheckpointKind kind);
+
+public:
+	template <typename T>
+	bool read(T& value)
+	{
+		static_assert(std::is_trivially_copyable_v<T>, "Checkpoints hold plain values only");
+		return readBytes(&value, sizeof(value));
+	}
+
+	bool readBytes(void* data, size_t size);
+	bool readString(std::string& text);
+
+public:
+	bool isOpen() const;
+	bool isAtEnd() const;
+
+private:
+	std::vector<char> m_payload;
+	size_t m_offset = 0;
+	bool m_isOpen = false;
+};
+
+bool checkpointExists(const std::string& path);
+
+#endif // CHECKPOINT_H
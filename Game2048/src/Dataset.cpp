@@ -0,0 +1,206 @@
+#include "Dataset.h"
+
+#include <algorithm>
+
+namespace
+{
+	constexpr std::array<char, 8> DATASET_MAGIC = { '2', '0', '4', '8', 'S', 'E', 'T', '\0' };
+	constexpr std::uint32_t DATASET_VERSION = 2;
+	constexpr std::array<char, 4> DATASET_DIRECTIONS = { 'w', 'a', 's', 'd' };
+	constexpr size_t DATASET_BLOCK_ROWS = size_t{ 1 } << 16;
+	constexpr size_t DATASET_ALIGNMENT = 8;
+
+	static_assert(sizeof(DatasetFileHeader) == 32, "Dataset file header must have no padding");
+	static_assert(sizeof(DatasetBlockHeader) == 32, "Dataset block header must have no padding");
+	static_assert(sizeof(DatasetFileHeader) % DATASET_ALIGNMENT == 0 && sizeof(DatasetBlockHeader) % DATASET_ALIGNMENT == 0,
+		"Headers must keep the columns after them aligned");
+
+	size_t alignUp(size_t bytes)
+	{
+		return (bytes + DATASET_ALIGNMENT - 1) / DATASET_ALIGNMENT * DATASET_ALIGNMENT;
+	}
+
+	// Pads the column out to the next column's offset
+	template <typename T>
+	bool writeColumn(std::ofstream& file, const std::vector<T>& column)
+	{
+		const std::array<char, DATASET_ALIGNMENT> k_padding {};
+		const size_t k_bytes = column.size() * sizeof(T);
+		return file.write(reinterpret_cast<const char*>(column.data()), static_cast<std::streamsize>(k_bytes))
+			&& file.write(k_padding.data(), static_cast<std::streamsize>(alignUp(k_bytes) - k_bytes));
+	}
+
+	template <typename T>
+	bool readColumn(std::ifstream& file, std::streamoff blockStart, std::uint32_t offset, std::vector<T>& column, size_t size)
+	{
+		column.resize(size);
+		return file.seekg(blockStart + static_cast<std::streamoff>(offset))
+			&& file.read(reinterpret_cast<char*>(column.data()), static_cast<std::streamsize>(size * sizeof(T)));
+	}
+}
+
+DatasetBlockHeader makeDatasetBlockHeader(size_t rowCount, std::uint32_t stateWords)
+{
+	const std::array<size_t, DATASET_COLUMN_COUNT> k_rowBytes = {
+		stateWords * sizeof(std::uint64_t), stateWords * sizeof(std::uint64_t), sizeof(std::int32_t), sizeof(std::uint8_t), sizeof(std::uint8_t) };
+
+	DatasetBlockHeader header;
+	header.rowCount = static_cast<std::uint32_t>(rowCount);
+	size_t offset = sizeof(DatasetBlockHeader);
+	for (size_t column = 0; column < DATASET_COLUMN_COUNT; ++column)
+	{
+		header.columnOffsets[column] = static_cast<std::uint32_t>(offset);
+		offset += alignUp(rowCount * k_rowBytes[column]);
+	}
+	header.blockBytes = static_cast<std::uint32_t>(offset);
+	return header;
+}
+
+size_t DatasetBlock::getRowCount() const
+{
+	return rewards.size();
+}
+
+void DatasetBlock::clear()
+{
+	states.clear();
+	nextStates.clear();
+	rewards.clear();
+	actions.clear();
+	terminals.clear();
+}
+
+DatasetFileHeader makeDatasetFileHeader(int boardHeight, int boardWidth, std::uint64_t seed)
+{
+	const auto k_cells = static_cast<size_t>(boardHeight) * static_cast<size_t>(boardWidth);
+
+	DatasetFileHeader header;
+	header.magic = DATASET_MAGIC;
+	header.version = DATASET_VERSION;
+	header.boardHeight = static_cast<std::uint32_t>(boardHeight);
+	header.boardWidth = static_cast<std::uint32_t>(boardWidth);
+	header.stateWords = k_cells <= PackedBoard::CELLS_PER_WORD ? 1 : 2;
+	header.seed = seed;
+	return header;
+}
+
+bool isValidDatasetFileHeader(const DatasetFileHeader& header)
+{
+	const std::uint64_t k_cells = std::uint64_t{ header.boardHeight } * header.boardWidth;
+	return header.magic == DATASET_MAGIC && header.version == DATASET_VERSION
+		&& k_cells > 0 && k_cells <= PackedBoard::MAX_CELLS
+		&& header.stateWords == (k_cells <= PackedBoard::CELLS_PER_WORD ? 1u : 2u);
+}
+
+DatasetWriter::DatasetWriter(const std::string& path, const DatasetFileHeader& header) :
+	m_header(header),
+	m_file(path, std::ios::binary | std::ios::trunc)
+{
+	m_isGood = m_file.is_open() && isValidDatasetFileHeader(header)
+		&& m_file.write(reinterpret_cast<const char*>(&m_header), sizeof(m_header));
+	if (!m_isGood) { return; }
+
+	// A game that ends just short of a full block pushes it past DATASET_BLOCK_ROWS
+	const size_t k_rows = 2 * DATASET_BLOCK_ROWS;
+	m_block.states.reserve(k_rows * m_header.stateWords);
+	m_block.nextStates.reserve(k_rows * m_header.stateWords);
+	m_block.rewards.reserve(k_rows);
+	m_block.actions.reserve(k_rows);
+	m_block.terminals.reserve(k_rows);
+}
+
+DatasetWriter::~DatasetWriter()
+{
+	close();
+}
+
+void DatasetWriter::addMove(const PackedBoard& state, char direction, int reward, const PackedBoard& nextState)
+{
+	appendState(m_block.states, state);
+	appendState(m_block.nextStates, nextState);
+	m_block.rewards.push_back(reward);
+	m_block.actions.push_back(static_cast<std::uint8_t>(
+		(std::find(DATASET_DIRECTIONS.begin(), DATASET_DIRECTIONS.end(), direction) - DATASET_DIRECTIONS.begin()) & 3));
+	m_block.terminals.push_back(0);
+}
+
+bool DatasetWriter::endGame()
+{
+	if (!m_block.terminals.empty()) { m_block.terminals.back() = 1; }
+	return (m_block.getRowCount() < DATASET_BLOCK_ROWS) || flushBlock();
+}
+
+bool DatasetWriter::close()
+{
+	if (!m_file.is_open()) { return m_isGood; }
+
+	flushBlock();
+	m_file.close();
+	m_isGood = m_isGood && !m_file.fail();
+	return m_isGood;
+}
+
+bool DatasetWriter::isOpen() const
+{
+	return m_isGood;
+}
+
+void DatasetWriter::appendState(std::vector<std::uint64_t>& column, const PackedBoard& board) const
+{
+	column.insert(column.end(), board.nibbles.begin(), board.nibbles.begin() + m_header.stateWords);
+}
+
+// One write per column: a block is a few megabytes written front to back
+bool DatasetWriter::flushBlock()
+{
+	if (m_isGood && m_block.getRowCount() > 0)
+	{
+		const DatasetBlockHeader k_header = makeDatasetBlockHeader(m_block.getRowCount(), m_header.stateWords);
+		m_isGood = m_file.write(reinterpret_cast<const char*>(&k_header), sizeof(k_header))
+			&& writeColumn(m_file, m_block.states) && writeColumn(m_file, m_block.nextStates)
+			&& writeColumn(m_file, m_block.rewards) && writeColumn(m_file, m_block.actions) && writeColumn(m_file, m_block.terminals);
+	}
+	m_block.clear();
+	return m_isGood;
+}
+
+DatasetReader::DatasetReader(const std::string& path) :
+	m_file(path, std::ios::binary)
+{
+	m_file.seekg(0, std::ios::end);
+	m_fileSize = static_cast<std::uint64_t>(std::max<std::streamoff>(m_file.tellg(), 0));
+	m_file.seekg(0);
+	m_isOpen = m_file.read(reinterpret_cast<char*>(&m_header), sizeof(m_header)) && isValidDatasetFileHeader(m_header);
+}
+
+bool DatasetReader::next(DatasetBlock& block)
+{
+	if (!m_isOpen) { return false; }
+
+	const std::streamoff k_blockStart = m_file.tellg();
+	DatasetBlockHeader header;
+	if (!m_file.read(reinterpret_cast<char*>(&header), sizeof(header))) { return false; }
+
+	// Columns are read whole; a layout other than the one the row count implies, or one
+	// that runs past the end, means a damaged file
+	const size_t k_rows = header.rowCount;
+	if (header != makeDatasetBlockHeader(k_rows, m_header.stateWords)
+		|| static_cast<std::uint64_t>(k_blockStart) + header.blockBytes > m_fileSize) { return false; }
+
+	return readColumn(m_file, k_blockStart, header.columnOffsets[DATASET_STATES], block.states, k_rows * m_header.stateWords)
+		&& readColumn(m_file, k_blockStart, header.columnOffsets[DATASET_NEXT_STATES], block.nextStates, k_rows * m_header.stateWords)
+		&& readColumn(m_file, k_blockStart, header.columnOffsets[DATASET_REWARDS], block.rewards, k_rows)
+		&& readColumn(m_file, k_blockStart, header.columnOffsets[DATASET_ACTIONS], block.actions, k_rows)
+		&& readColumn(m_file, k_blockStart, header.columnOffsets[DATASET_TERMINALS], block.terminals, k_rows)
+		&& m_file.seekg(k_blockStart + static_cast<std::streamoff>(header.blockBytes));
+}
+
+bool DatasetReader::isOpen() const
+{
+	return m_isOpen;
+}
+
+const DatasetFileHeader& DatasetReader::getHeader() const
+{
+	return m_header;
+}
@@ -0,0 +1,121 @@
+#ifndef DATASET_H
+#define DATASET_H
+
+#include "PackedBoard.h"
+
+#include <array>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Starts every dataset file; little-endian. Blocks follow back to back, each a
+// DatasetBlockHeader and then rowCount entries of every column in turn:
+//   states       stateWords uint64 per row, PackedBoard nibbles before the move
+//   next states  stateWords uint64 per row, after the move and its spawn
+//   rewards      int32, the score the move earned
+//   actions      uint8, the direction as 0-3 for w, a, s, d
+//   terminals    uint8, 1 on the last move of a game
+// Every column is zero padded to a multiple of 8 bytes, so each starts 8-byte aligned
+// in the file and can be used in place from a mapping at the offset its header gives.
+// Blocks hold whole games. stateWords is 1 for boards of up to 16 cells, else 2.
+struct DatasetFileHeader
+{
+	std::array<char, 8> magic {};
+	std::uint32_t version = 0;
+	std::uint32_t boardHeight = 0;
+	std::uint32_t boardWidth = 0;
+	std::uint32_t stateWords = 0;
+	std::uint64_t seed = 0;
+};
+
+enum DatasetColumn : size_t
+{
+	DATASET_STATES,
+	DATASET_NEXT_STATES,
+	DATASET_REWARDS,
+	DATASET_ACTIONS,
+	DATASET_TERMINALS,
+	DATASET_COLUMN_COUNT
+};
+
+struct DatasetBlockHeader
+{
+	std::uint32_t rowCount = 0;
+	std::uint32_t blockBytes = 0;		// Header, columns and padding; the next block starts this far on
+	std::array<std::uint32_t, DATASET_COLUMN_COUNT> columnOffsets {};		// From the start of the header
+	std::uint32_t reserved = 0;
+
+	friend bool operator==(const DatasetBlockHeader& lhs, const DatasetBlockHeader& rhs) = default;
+};
+
+DatasetBlockHeader makeDatasetBlockHeader(size_t rowCount, std::uint32_t stateWords);
+
+// One block's columns; states hold stateWords words per row
+struct DatasetBlock
+{
+	std::vector<std::uint64_t> states;
+	std::vector<std::uint64_t> nextStates;
+	std::vector<std::int32_t> rewards;
+	std::vector<std::uint8_t> actions;
+	std::vector<std::uint8_t> terminals;
+
+	size_t getRowCount() const;
+	void clear();
+};
+
+DatasetFileHeader makeDatasetFileHeader(int boardHeight, int boardWidth, std::uint64_t seed);		// Boards of up to 32 cells
+bool isValidDatasetFileHeader(const DatasetFileHeader& header);
+
+// Rows are gathered column by column and written a block at a time, once a finished
+// game has filled the block; close() or the destructor writes what is left.
+class DatasetWriter
+{
+public:
+	DatasetWriter(const std::string& path, const DatasetFileHeader& header);
+	DatasetWriter(const DatasetWriter&) = delete;
+	DatasetWriter& operator=(const DatasetWriter&) = delete;
+	~DatasetWriter();
+
+public:
+	void addMove(const PackedBoard& state, char direction, int reward, const PackedBoard& nextState);
+	bool endGame();		// Marks the last move terminal
+	bool close();
+
+public:
+	bool isOpen() const;
+
+private:
+	void appendState(std::vector<std::uint64_t>& column, const PackedBoard& board) const;
+	bool flushBlock();
+
+private:
+	const DatasetFileHeader m_header;
+
+private:
+	std::ofstream m_file;
+	DatasetBlock m_block;
+	bool m_isGood = false;
+};
+
+// Reads a dataset file a block at a time
+class DatasetReader
+{
+public:
+	explicit DatasetReader(const std::string& path);
+
+public:
+	bool next(DatasetBlock& block);		// False at the end of the file or on a damaged block
+
+public:
+	bool isOpen() const;
+	const DatasetFileHeader& getHeader() const;
+
+private:
+	std::ifstream m_file;
+	DatasetFileHeader m_header;
+	std::uint64_t m_fileSize = 0;
+	bool m_isOpen = false;
+};
+
+#endif // DATASET_H
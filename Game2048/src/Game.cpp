@@ -1,11 +1,13 @@
 #include "Game.h"
 
+#include <chrono>
 #include <iostream>
 #include <string>
 
 inline constexpr int GAME_WIN_VALUE = 2048;
 inline constexpr int GAME_BOARD_HEIGHT = 5;
 inline constexpr int GAME_BOARD_WIDTH  = 4;
+inline constexpr std::chrono::milliseconds GAME_HINT_LATENCY_BUDGET { 200 };
 
 Game::Game(std::ostream& display, std::istream& keyboard) : 
 	m_board(GAME_WIN_VALUE, GAME_BOARD_HEIGHT, GAME_BOARD_WIDTH),
@@ -21,6 +23,13 @@ void Game::run()
 	while (m_board.canMove())
 	{
 		const char direction = getUserMoveDirection();
+		if (direction == 'h')
+		{
+			showHint();
+			continue;
+		}
+
+		stopHintSearch();
 		if (direction == 'r')
 		{
 			m_board = m_previousMoveBoards;
@@ -49,17 +58,50 @@ void Game::run()
 	}
 }
 
+// Headless counterpart of run(): the policy supplies every move, and the board is
+// rendered only every renderInterval moves (never when it is 0) without clearing the terminal
+void Game::autoPlay(Policy& policy, size_t renderInterval)
+{
+	reset();
+	policy.newGame();
+
+	size_t moveCount = 0;
+	while (m_board.canMove())
+	{
+		const char direction = policy.chooseMove(m_board);
+		if (direction == 0 || !m_board.move(direction)) { break; }
+
+		++moveCount;
+		if (renderInterval != 0 && moveCount % renderInterval == 0) { render(); }
+
+		if (m_board.reachedVictoryValue())
+		{
+			render();
+			handleWin();
+			return;
+		}
+	}
+
+	render();
+	handleLose();
+}
+
 void Game::display()
 {
 	system("cls");
+	render();
+	startHintSearch();
+}
 
+void Game::render()
+{
 	m_displayDevice << "Score: " << m_board.getScore() << '\n';
 	m_board.display(m_displayDevice);
 }
 
 char Game::getUserMoveDirection()
 {
-	m_displayDevice << "Enter a move (w/a/s/d) or (r) to restore last move: ";
+	m_displayDevice << "Enter a move (w/a/s/d), (r) to restore last move or (h) for a hint: ";
 	
 	std::string input;
 	std::getline(m_inputDevice, input);
@@ -79,4 +121,44 @@ void Game::handleWin()
 void Game::handleLose() 
 {
 	m_displayDevice << "Game over. You lose.\n";
+}
+
+void Game::startHintSearch()
+{
+	stopHintSearch();
+
+	std::promise<SearchResult> hint;
+	m_hint = hint.get_future().share();
+	m_hintWorker = std::jthread([this, board = m_board, hint = std::move(hint)](std::stop_token stopToken) mutable
+	{
+		hint.set_value(m_solver.findBestMove(board, GAME_HINT_LATENCY_BUDGET, stopToken));
+
+		// Keep searching the positions that can follow until the user commits to a move
+		m_solver.ponder(board, stopToken);
+	});
+}
+
+void Game::stopHintSearch()
+{
+	// The solver is not thread-safe: the previous search must finish before a new one starts
+	if (m_hintWorker.joinable())
+	{
+		m_hintWorker.request_stop();
+		m_hintWorker.join();
+	}
+}
+
+void Game::showHint()
+{
+	if (!m_hint.valid()) { return; }
+
+	const SearchResult& hint = m_hint.get();
+	if (hint.direction == 0)
+	{
+		m_displayDevice << "Hint: no move left.\n";
+		return;
+	}
+
+	m_displayDevice << "Hint: move (" << hint.direction << "), expected value " << hint.expectedValue
+		<< ", searched " << hint.depth << " moves ahead.\n";
 }
\ No newline at end of file
@@ -2,19 +2,28 @@
 #define GAME_H
 
 #include "Board.h"
+#include "Policy.h"
+#include "Solver.h"
 #include <iosfwd>
+#include <future>
+#include <thread>
 
 class Game {
 public:
 	Game(std::ostream& os, std::istream& is);
 	void run();
+	void autoPlay(Policy& policy, size_t renderInterval);
 
 private:
 	char getUserMoveDirection();
 	void display();
+	void render();
 	void reset();
 	void handleWin();
 	void handleLose();
+	void startHintSearch();
+	void stopHintSearch();
+	void showHint();
 
 private:
 	Board m_board;
@@ -22,6 +31,11 @@ private:
 	
 	std::ostream& m_displayDevice;
 	std::istream& m_inputDevice;
+
+private: // Hint search and pondering run while the user is reading the board
+	Solver m_solver;
+	std::shared_future<SearchResult> m_hint;
+	std::jthread m_hintWorker;
 };
 
 #endif // GAME_H
\ No newline at end of file
@@ -0,0 +1,179 @@
+#include "GameRecord.h"
+
+#include <algorithm>
+
+namespace
+{
+	constexpr std::array<char, 8> GAME_RECORD_MAGIC = { '2', '0', '4', '8', 'R', 'E', 'C', '\0' };
+	constexpr std::uint32_t GAME_RECORD_VERSION = 1;
+	constexpr std::array<char, 4> GAME_RECORD_DIRECTIONS = { 'w', 'a', 's', 'd' };
+	constexpr int GAME_RECORD_CELL_SHIFT = 3;
+	constexpr std::uint32_t GAME_RECORD_FOUR_BIT = 1u << 2;
+	constexpr size_t GAME_RECORD_MAX_CELLS = (size_t{ 1 } << (16 - GAME_RECORD_CELL_SHIFT));
+	constexpr size_t GAME_RECORD_BUFFER_BYTES = size_t{ 1 } << 20;
+
+	static_assert(sizeof(GameRecordFileHeader) == 40, "Record file header must have no padding");
+	static_assert(sizeof(GameRecordHeader) == 16, "Game record header must have no padding");
+
+	void appendBytes(std::vector<char>& buffer, const void* data, size_t size)
+	{
+		const auto* bytes = static_cast<const char*>(data);
+		buffer.insert(buffer.end(), bytes, bytes + size);
+	}
+
+	void appendCode(std::vector<char>& buffer, std::uint32_t code, std::uint32_t bytesPerTurn)
+	{
+		for (std::uint32_t k = 0; k < bytesPerTurn; ++k) { buffer.push_back(static_cast<char>((code >> (8 * k)) & 0xFF)); }
+	}
+}
+
+GameRecordFileHeader makeGameRecordFileHeader(int boardHeight, int boardWidth, int winValue, std::uint64_t seed, size_t openingSpawns)
+{
+	const auto k_cells = static_cast<size_t>(boardHeight) * static_cast<size_t>(boardWidth);
+
+	GameRecordFileHeader header;
+	header.magic = GAME_RECORD_MAGIC;
+	header.version = GAME_RECORD_VERSION;
+	header.boardHeight = static_cast<std::uint32_t>(boardHeight);
+	header.boardWidth = static_cast<std::uint32_t>(boardWidth);
+	header.winValue = winValue;
+	header.bytesPerTurn = (k_cells << GAME_RECORD_CELL_SHIFT) <= 0x100 ? 1 : 2;
+	header.openingSpawns = static_cast<std::uint32_t>(openingSpawns);
+	header.seed = seed;
+	return header;
+}
+
+bool isValidGameRecordFileHeader(const GameRecordFileHeader& header)
+{
+	const std::uint64_t k_cells = std::uint64_t{ header.boardHeight } * header.boardWidth;
+	return header.magic == GAME_RECORD_MAGIC && header.version == GAME_RECORD_VERSION
+		&& k_cells > 0 && k_cells <= GAME_RECORD_MAX_CELLS
+		&& (header.bytesPerTurn == 1 || header.bytesPerTurn == 2)
+		&& (k_cells << GAME_RECORD_CELL_SHIFT) <= (std::uint64_t{ 1 } << (8 * header.bytesPerTurn))
+		&& header.openingSpawns <= k_cells;
+}
+
+std::uint32_t encodeTurn(char direction, const RecordedSpawn& spawn)
+{
+	const auto k_direction = static_cast<std::uint32_t>(
+		std::find(GAME_RECORD_DIRECTIONS.begin(), GAME_RECORD_DIRECTIONS.end(), direction) - GAME_RECORD_DIRECTIONS.begin()) & 3;
+	return k_direction | (spawn.tile == 4 ? GAME_RECORD_FOUR_BIT : 0) | (static_cast<std::uint32_t>(spawn.cell) << GAME_RECORD_CELL_SHIFT);
+}
+
+std::uint32_t readTurnCode(const unsigned char* bytes, std::uint32_t bytesPerTurn)
+{
+	std::uint32_t code = 0;
+	for (std::uint32_t k = 0; k < bytesPerTurn; ++k) { code |= static_cast<std::uint32_t>(bytes[k]) << (8 * k); }
+	return code;
+}
+
+RecordedTurn decodeTurn(std::uint32_t code)
+{
+	RecordedTurn turn;
+	turn.direction = GAME_RECORD_DIRECTIONS[code & 3];
+	turn.spawn.tile = (code & GAME_RECORD_FOUR_BIT) ? 4 : 2;
+	turn.spawn.cell = static_cast<std::uint16_t>(code >> GAME_RECORD_CELL_SHIFT);
+	return turn;
+}
+
+GameRecordWriter::GameRecordWriter(const std::string& path, const GameRecordFileHeader& header) :
+	m_header(header),
+	m_file(path, std::ios::binary | std::ios::trunc)
+{
+	m_buffer.reserve(GAME_RECORD_BUFFER_BYTES);
+	m_isGood = m_file.is_open() && isValidGameRecordFileHeader(header);
+	if (m_isGood) { appendBytes(m_buffer, &m_header, sizeof(m_header)); }
+}
+
+GameRecordWriter::~GameRecordWriter()
+{
+	close();
+}
+
+bool GameRecordWriter::write(const GameRecord& record)
+{
+	if (!m_isGood) { return false; }
+
+	GameRecordHeader header;
+	header.game = record.game;
+	header.turnCount = static_cast<std::uint32_t>(record.turns.size());
+	header.finalScore = record.finalScore;
+	appendBytes(m_buffer, &header, sizeof(header));
+	for (const RecordedSpawn& spawn : record.openingSpawns) { appendCode(m_buffer, encodeTurn('w', spawn), m_header.bytesPerTurn); }
+	for (const RecordedTurn& turn : record.turns) { appendCode(m_buffer, encodeTurn(turn.direction, turn.spawn), m_header.bytesPerTurn); }
+
+	return (m_buffer.size() < GAME_RECORD_BUFFER_BYTES) || flushBuffer();
+}
+
+bool GameRecordWriter::close()
+{
+	if (!m_file.is_open()) { return m_isGood; }
+
+	flushBuffer();
+	m_file.close();
+	m_isGood = m_isGood && !m_file.fail();
+	return m_isGood;
+}
+
+bool GameRecordWriter::isOpen() const
+{
+	return m_isGood;
+}
+
+bool GameRecordWriter::flushBuffer()
+{
+	if (m_isGood && !m_buffer.empty())
+	{
+		m_isGood = static_cast<bool>(m_file.write(m_buffer.data(), static_cast<std::streamsize>(m_buffer.size())));
+	}
+	m_buffer.clear();
+	return m_isGood;
+}
+
+GameRecordReader::GameRecordReader(const std::string& path) :
+	m_file(path, std::ios::binary)
+{
+	m_file.seekg(0, std::ios::end);
+	m_fileSize = static_cast<std::uint64_t>(std::max<std::streamoff>(m_file.tellg(), 0));
+	m_file.seekg(0);
+	m_isOpen = m_file.read(reinterpret_cast<char*>(&m_header), sizeof(m_header)) && isValidGameRecordFileHeader(m_header);
+}
+
+bool GameRecordReader::next(GameRecord& record)
+{
+	if (!m_isOpen) { return false; }
+
+	GameRecordHeader header;
+	if (!m_file.read(reinterpret_cast<char*>(&header), sizeof(header))) { return false; }
+
+	// Codes are read in one block; counts that run past the end mean a damaged file
+	const size_t k_codes = m_header.openingSpawns + size_t{ header.turnCount };
+	if (static_cast<std::uint64_t>(m_file.tellg()) + k_codes * m_header.bytesPerTurn > m_fileSize) { return false; }
+	m_codes.resize(k_codes * m_header.bytesPerTurn);
+	if (!m_file.read(reinterpret_cast<char*>(m_codes.data()), static_cast<std::streamsize>(m_codes.size()))) { return false; }
+
+	record.game = header.game;
+	record.finalScore = header.finalScore;
+	record.openingSpawns.resize(m_header.openingSpawns);
+	record.turns.resize(header.turnCount);
+	const size_t k_cells = size_t{ m_header.boardHeight } * m_header.boardWidth;
+	for (size_t k = 0; k < k_codes; ++k)
+	{
+		const RecordedTurn turn = decodeTurn(readTurnCode(m_codes.data() + k * m_header.bytesPerTurn, m_header.bytesPerTurn));
+		if (turn.spawn.cell >= k_cells) { return false; }
+
+		if (k < m_header.openingSpawns) { record.openingSpawns[k] = turn.spawn; }
+		else { record.turns[k - m_header.openingSpawns] = turn; }
+	}
+	return true;
+}
+
+bool GameRecordReader::isOpen() const
+{
+	return m_isOpen;
+}
+
+const GameRecordFileHeader& GameRecordReader::getHeader() const
+{
+	return m_header;
+}
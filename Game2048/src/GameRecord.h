@@ -0,0 +1,111 @@
+#ifndef GAME_RECORD_H
+#define GAME_RECORD_H
+
+#include <array>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+struct RecordedSpawn
+{
+	std::uint16_t cell = 0;		// Row-major index
+	int tile = 2;
+};
+
+struct RecordedTurn
+{
+	char direction = 0;
+	RecordedSpawn spawn;		// Every legal slide leaves an empty cell, so every turn has one
+};
+
+struct GameRecord
+{
+	std::uint64_t game = 0;		// Index in the run, which with the file's seed regenerates the spawns
+	int finalScore = 0;
+	std::vector<RecordedSpawn> openingSpawns;
+	std::vector<RecordedTurn> turns;
+};
+
+// Starts every record file; little-endian. Games follow back to back, each a
+// GameRecordHeader and then openingSpawns + turnCount codes of bytesPerTurn bytes:
+// the direction in bits 0-1 (w, a, s, d), a spawned 4 in bit 2 and the cell above.
+// Boards of up to 32 cells take one byte per turn.
+struct GameRecordFileHeader
+{
+	std::array<char, 8> magic {};
+	std::uint32_t version = 0;
+	std::uint32_t boardHeight = 0;
+	std::uint32_t boardWidth = 0;
+	std::int32_t winValue = 0;
+	std::uint32_t bytesPerTurn = 0;
+	std::uint32_t openingSpawns = 0;
+	std::uint64_t seed = 0;
+};
+
+struct GameRecordHeader
+{
+	std::uint64_t game = 0;
+	std::uint32_t turnCount = 0;
+	std::int32_t finalScore = 0;
+};
+
+GameRecordFileHeader makeGameRecordFileHeader(int boardHeight, int boardWidth, int winValue, std::uint64_t seed, size_t openingSpawns);
+bool isValidGameRecordFileHeader(const GameRecordFileHeader& header);
+
+// Codes are gathered in a buffer and written in large blocks; close() or the destructor
+// writes what is left. A game is written whole or, once a write has failed, not at all.
+class GameRecordWriter
+{
+public:
+	GameRecordWriter(const std::string& path, const GameRecordFileHeader& header);
+	GameRecordWriter(const GameRecordWriter&) = delete;
+	GameRecordWriter& operator=(const GameRecordWriter&) = delete;
+	~GameRecordWriter();
+
+public:
+	bool write(const GameRecord& record);
+	bool close();
+
+public:
+	bool isOpen() const;
+
+private:
+	bool flushBuffer();
+
+private:
+	const GameRecordFileHeader m_header;
+
+private:
+	std::ofstream m_file;
+	std::vector<char> m_buffer;
+	bool m_isGood = false;
+};
+
+// Reads a record file from front to back
+class GameRecordReader
+{
+public:
+	explicit GameRecordReader(const std::string& path);
+
+public:
+	bool next(GameRecord& record);		// False at the end of the file or on a damaged game
+
+public:
+	bool isOpen() const;
+	const GameRecordFileHeader& getHeader() const;
+
+private:
+	std::ifstream m_file;
+	GameRecordFileHeader m_header;
+	std::vector<unsigned char> m_codes;
+	std::uint64_t m_fileSize = 0;
+	bool m_isOpen = false;
+};
+
+// Codes of one turn, shared by the writer and every reader
+std::uint32_t encodeTurn(char direction, const RecordedSpawn& spawn);
+RecordedTurn decodeTurn(std::uint32_t code);
+std::uint32_t readTurnCode(const unsigned char* bytes, std::uint32_t bytesPerTurn);
+
+#endif // GAME_RECORD_H
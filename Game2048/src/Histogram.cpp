@@ -0,0 +1,87 @@
+#include "Histogram.h"
+#include "Checkpoint.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+void Histogram::record(std::uint64_t value)
+{
+	++m_counts[bucketOf(value)];
+	++m_count;
+	m_max = std::max(m_max, value);
+}
+
+void Histogram::merge(const Histogram& other)
+{
+	for (size_t bucket = 0; bucket < BUCKET_COUNT; ++bucket) { m_counts[bucket] += other.m_counts[bucket]; }
+	m_count += other.m_count;
+	m_max = std::max(m_max, other.m_max);
+}
+
+std::uint64_t Histogram::getCount() const
+{
+	return m_count;
+}
+
+std::uint64_t Histogram::getMax() const
+{
+	return m_max;
+}
+
+// Nearest-rank: the smallest recorded value with at least percent% of the values at or below it
+std::uint64_t Histogram::percentile(double percent) const
+{
+	if (m_count == 0) { return 0; }
+
+	const auto k_rank = std::max<std::uint64_t>(1, static_cast<std::uint64_t>(std::ceil(percent / 100.0 * static_cast<double>(m_count))));
+	std::uint64_t seen = 0;
+	for (size_t bucket = 0; bucket < BUCKET_COUNT; ++bucket)
+	{
+		seen += m_counts[bucket];
+		if (seen >= k_rank) { return bucketLowerBound(bucket); }
+	}
+	return m_max;
+}
+
+// A value inside a bucket counts only the buckets above it, so the result never overstates
+std::uint64_t Histogram::countAtLeast(std::uint64_t value) const
+{
+	size_t first = bucketOf(value);
+	if (bucketLowerBound(first) != value) { ++first; }
+
+	std::uint64_t count = 0;
+	for (size_t bucket = first; bucket < BUCKET_COUNT; ++bucket) { count += m_counts[bucket]; }
+	return count;
+}
+
+void Histogram::save(CheckpointWriter& checkpoint) const
+{
+	checkpoint.write(m_counts);
+	checkpoint.write(m_count);
+	checkpoint.write(m_max);
+}
+
+bool Histogram::load(CheckpointReader& checkpoint)
+{
+	return checkpoint.read(m_counts) && checkpoint.read(m_count) && checkpoint.read(m_max);
+}
+
+size_t Histogram::bucketOf(std::uint64_t value)
+{
+	if (value < SUB_BUCKETS) { return static_cast<size_t>(value); }
+
+	const int k_exponent = std::bit_width(value) - 1;
+	const int k_shift = k_exponent - SUB_BUCKET_BITS;
+	const auto k_subBucket = static_cast<size_t>((value >> k_shift) & (SUB_BUCKETS - 1));
+	return SUB_BUCKETS + static_cast<size_t>(k_shift) * SUB_BUCKETS + k_subBucket;
+}
+
+std::uint64_t Histogram::bucketLowerBound(size_t bucket)
+{
+	if (bucket < SUB_BUCKETS) { return bucket; }
+
+	const size_t k_shift = (bucket - SUB_BUCKETS) / SUB_BUCKETS;
+	const size_t k_subBucket = (bucket - SUB_BUCKETS) % SUB_BUCKETS;
+	return static_cast<std::uint64_t>(SUB_BUCKETS + k_subBucket) << k_shift;
+}
@@ -0,0 +1,48 @@
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+class CheckpointReader;
+class CheckpointWriter;
+
+// Counts of non-negative values in log-linear buckets: one per value below 2^SUB_BUCKET_BITS,
+// then every power-of-two range split into 2^SUB_BUCKET_BITS equal buckets, so a percentile
+// reads less than 1/32 below the true value and powers of two read back exactly. Storage is
+// fixed: recording never allocates, and histograms merge by adding counts, so every thread
+// keeps its own and they are summed once at the end.
+class Histogram
+{
+public:
+	static constexpr int SUB_BUCKET_BITS = 5;
+	static constexpr size_t SUB_BUCKETS = size_t{ 1 } << SUB_BUCKET_BITS;
+	static constexpr size_t BUCKET_COUNT = SUB_BUCKETS + (64 - SUB_BUCKET_BITS) * SUB_BUCKETS;
+
+public:
+	void record(std::uint64_t value);
+	void merge(const Histogram& other);
+
+public:
+	std::uint64_t getCount() const;
+	std::uint64_t getMax() const;
+	std::uint64_t percentile(double percent) const;		// Lower bound of the bucket holding that rank
+	std::uint64_t countAtLeast(std::uint64_t value) const;	// Exact when value starts a bucket
+
+public:
+	void save(CheckpointWriter& checkpoint) const;
+	bool load(CheckpointReader& checkpoint);
+	friend bool operator==(const Histogram& lhs, const Histogram& rhs) = default;
+
+public:
+	static size_t bucketOf(std::uint64_t value);
+	static std::uint64_t bucketLowerBound(size_t bucket);
+
+private:
+	std::array<std::uint64_t, BUCKET_COUNT> m_counts {};
+	std::uint64_t m_count = 0;
+	std::uint64_t m_max = 0;
+};
+
+#endif // HISTOGRAM_H
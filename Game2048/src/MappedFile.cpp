@@ -0,0 +1,111 @@
+#include "MappedFile.h"
+
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+MappedFile::MappedFile(const std::string& path)
+{
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE) { return; }
+	m_file = file;
+
+	LARGE_INTEGER size {};
+	if (!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+	{
+		close();
+		return;
+	}
+
+	m_mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	const void* view = m_mapping ? MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+	if (!view)
+	{
+		close();
+		return;
+	}
+	m_data = static_cast<const std::byte*>(view);
+	m_size = static_cast<size_t>(size.QuadPart);
+}
+
+void MappedFile::close()
+{
+	if (m_data) { UnmapViewOfFile(m_data); }
+	if (m_mapping) { CloseHandle(m_mapping); }
+	if (m_file) { CloseHandle(m_file); }
+	m_data = nullptr;
+	m_size = 0;
+	m_mapping = nullptr;
+	m_file = nullptr;
+}
+#else
+MappedFile::MappedFile(const std::string& path)
+{
+	const int file = ::open(path.c_str(), O_RDONLY);
+	if (file < 0) { return; }
+
+	// The mapping keeps the file alive on its own, so the descriptor can go right away
+	struct stat status {};
+	if (fstat(file, &status) == 0 && status.st_size > 0)
+	{
+		void* view = mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ, MAP_SHARED, file, 0);
+		if (view != MAP_FAILED)
+		{
+			m_data = static_cast<const std::byte*>(view);
+			m_size = static_cast<size_t>(status.st_size);
+		}
+	}
+	::close(file);
+}
+
+void MappedFile::close()
+{
+	if (m_data) { munmap(const_cast<std::byte*>(m_data), m_size); }
+	m_data = nullptr;
+	m_size = 0;
+}
+#endif
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+{
+	*this = std::move(other);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+{
+	if (this == &other) { return *this; }
+
+	close();
+	m_data = std::exchange(other.m_data, nullptr);
+	m_size = std::exchange(other.m_size, 0);
+#ifdef _WIN32
+	m_file = std::exchange(other.m_file, nullptr);
+	m_mapping = std::exchange(other.m_mapping, nullptr);
+#endif
+	return *this;
+}
+
+MappedFile::~MappedFile()
+{
+	close();
+}
+
+bool MappedFile::isOpen() const
+{
+	return m_data != nullptr;
+}
+
+std::span<const std::byte> MappedFile::getBytes() const
+{
+	return { m_data, m_size };
+}
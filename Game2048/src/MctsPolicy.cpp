@@ -0,0 +1,569 @@
+#include "MctsPolicy.h"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <thread>
+#include <utility>
+
+namespace
+{
+	constexpr char MCTS_DIRECTIONS[] = { 'w', 'a', 's', 'd' };
+	constexpr size_t MCTS_DIRECTION_COUNT = std::size(MCTS_DIRECTIONS);
+
+	enum ScratchBoard : size_t
+	{
+		SCRATCH_PATH,
+		SCRATCH_PROBE,
+		SCRATCH_COUNT
+	};
+
+	enum NodeState : std::uint8_t
+	{
+		NODE_UNEXPANDED,
+		NODE_EXPANDING,
+		NODE_EXPANDED
+	};
+
+	void updateMinimum(std::atomic<double>& minimum, double value)
+	{
+		double current = minimum.load(std::memory_order_relaxed);
+		while (value < current && !minimum.compare_exchange_weak(current, value, std::memory_order_relaxed)) {}
+	}
+
+	void updateMaximum(std::atomic<double>& maximum, double value)
+	{
+		double current = maximum.load(std::memory_order_relaxed);
+		while (value > current && !maximum.compare_exchange_weak(current, value, std::memory_order_relaxed)) {}
+	}
+
+	void copyNode(const MctsNode& from, MctsNode& to)
+	{
+		to.valueSum.store(from.valueSum.load(std::memory_order_relaxed), std::memory_order_relaxed);
+		to.visits.store(from.visits.load(std::memory_order_relaxed), std::memory_order_relaxed);
+		to.move = from.move;
+		to.tile = from.tile;
+		to.state.store(from.state.load(std::memory_order_relaxed), std::memory_order_relaxed);
+	}
+
+	// Breadth first, so every node's children land in one block next to their siblings.
+	// The target must be empty and at least as large as the subtree.
+	std::uint32_t copySubtree(const NodeArena& from, std::uint32_t root, NodeArena& to)
+	{
+		const std::uint32_t copiedRoot = to.allocate();
+		copyNode(from[root], to[copiedRoot]);
+
+		std::vector<std::pair<std::uint32_t, std::uint32_t>> pending { { root, copiedRoot } };
+		for (size_t next = 0; next < pending.size(); ++next)
+		{
+			const auto [original, copy] = pending[next];
+
+			std::uint32_t childCount = 0;
+			for (std::uint32_t child = from[original].firstChild; child != NodeArena::NO_NODE; child = from[child].nextSibling) { ++childCount; }
+			if (childCount == 0) { continue; }
+
+			const std::uint32_t children = to.allocate(childCount);
+			assert(children != NodeArena::NO_NODE);
+			std::uint32_t copiedChild = children;
+			for (std::uint32_t child = from[original].firstChild; child != NodeArena::NO_NODE; child = from[child].nextSibling, ++copiedChild)
+			{
+				copyNode(from[child], to[copiedChild]);
+				to[copiedChild].nextSibling = (copiedChild + 1 < children + childCount) ? copiedChild + 1 : NodeArena::NO_NODE;
+				pending.emplace_back(child, copiedChild);
+			}
+			to[copy].firstChild.store(children, std::memory_order_relaxed);
+		}
+		return copiedRoot;
+	}
+}
+
+NodeArena::NodeArena(size_t capacity) :
+	m_nodes(capacity + 1)
+{}
+
+std::uint32_t NodeArena::allocate(std::uint32_t count)
+{
+	// The counter may run past the end when threads race for the last nodes; size() clamps it.
+	// A block that does not fit is not handed out in part.
+	const size_t first = m_size.fetch_add(count, std::memory_order_relaxed);
+	if (first + count > m_nodes.size()) { return NO_NODE; }
+
+	for (size_t index = first; index < first + count; ++index)
+	{
+		MctsNode& node = m_nodes[index];
+		node.valueSum.store(0.0, std::memory_order_relaxed);
+		node.visits.store(0, std::memory_order_relaxed);
+		node.virtualLosses.store(0, std::memory_order_relaxed);
+		node.firstChild.store(NO_NODE, std::memory_order_relaxed);
+		node.nextSibling = NO_NODE;
+		node.move = 0;
+		node.tile = 0;
+		node.state.store(NODE_UNEXPANDED, std::memory_order_relaxed);
+	}
+	return static_cast<std::uint32_t>(first);
+}
+
+void NodeArena::reset()
+{
+	m_size.store(1, std::memory_order_relaxed);
+}
+
+void NodeArena::swap(NodeArena& other)
+{
+	m_nodes.swap(other.m_nodes);
+	const size_t size = m_size.load(std::memory_order_relaxed);
+	m_size.store(other.m_size.load(std::memory_order_relaxed), std::memory_order_relaxed);
+	other.m_size.store(size, std::memory_order_relaxed);
+}
+
+size_t NodeArena::size() const
+{
+	return std::min(m_size.load(std::memory_order_relaxed), m_nodes.size()) - 1;
+}
+
+size_t NodeArena::capacity() const
+{
+	return m_nodes.size() - 1;
+}
+
+MctsNode& NodeArena::operator[](std::uint32_t index)
+{
+	assert(index != NO_NODE && index < m_nodes.size());
+	return m_nodes[index];
+}
+
+const MctsNode& NodeArena::operator[](std::uint32_t index) const
+{
+	assert(index != NO_NODE && index < m_nodes.size());
+	return m_nodes[index];
+}
+
+MctsPolicy::Tree::Tree(size_t arenaCapacity) :
+	arena(arenaCapacity),
+	spareArena(arenaCapacity)
+{}
+
+MctsPolicy::MctsPolicy(const MctsSettings& settings) :
+	m_settings(settings),
+	m_seed(settings.seed)
+{}
+
+// A stop request makes each helper leave as soon as it passes the start barrier
+MctsPolicy::~MctsPolicy()
+{
+	if (m_helpers.empty()) { return; }
+
+	for (std::jthread& helper : m_helpers) { helper.request_stop(); }
+	m_decisionStart->arrive_and_wait();
+	m_helpers.clear();
+}
+
+char MctsPolicy::chooseMove(const Board& board)
+{
+	const size_t k_threadCount = std::max<size_t>(m_settings.threadCount, 1);
+	if (m_searchers.empty())
+	{
+		m_searchers.reserve(k_threadCount);
+		for (size_t t = 0; t < k_threadCount; ++t)
+		{
+			std::seed_seq streamSeed { m_seed, static_cast<std::uint64_t>(t) };
+			m_searchers.push_back(Searcher{ std::vector<Board>(SCRATCH_COUNT, board), {}, std::mt19937_64(streamSeed) });
+		}
+
+		const size_t k_treeCount = (m_settings.parallelism == MctsParallelism::Root) ? k_threadCount : 1;
+		for (size_t t = 0; t < k_treeCount; ++t) { m_trees.push_back(std::make_unique<Tree>(m_settings.arenaCapacity)); }
+
+		if (k_threadCount > 1)
+		{
+			m_decisionStart.emplace(static_cast<std::ptrdiff_t>(k_threadCount));
+			m_decisionEnd.emplace(static_cast<std::ptrdiff_t>(k_threadCount));
+			m_helpers.reserve(k_threadCount - 1);
+			for (size_t t = 1; t < k_threadCount; ++t)
+			{
+				m_helpers.emplace_back([this, t](std::stop_token stopToken) { runHelper(stopToken, t); });
+			}
+		}
+	}
+
+	for (const auto& tree : m_trees) { prepareRoot(*tree, board); }
+	m_reusedRootVisits = getRootVisits();
+
+	m_iterationTickets.store(0, std::memory_order_relaxed);
+	const auto deadline = std::chrono::steady_clock::now() + m_settings.budget;
+	if (!m_helpers.empty())
+	{
+		m_root = &board;
+		m_deadline = deadline;
+		m_decisionStart->arrive_and_wait();
+	}
+	search(m_searchers.front(), *m_trees.front(), board, deadline);
+	if (!m_helpers.empty()) { m_decisionEnd->arrive_and_wait(); }
+
+	// Root-parallel trees vote with their visit counts
+	std::array<std::uint64_t, MCTS_DIRECTION_COUNT> visitsPerMove {};
+	std::array<bool, MCTS_DIRECTION_COUNT> isLegal {};
+	for (const auto& tree : m_trees)
+	{
+		const NodeArena& arena = tree->arena;
+		for (std::uint32_t child = arena[tree->root].firstChild; child != NodeArena::NO_NODE; child = arena[child].nextSibling)
+		{
+			const size_t k = std::find(std::begin(MCTS_DIRECTIONS), std::end(MCTS_DIRECTIONS), static_cast<char>(arena[child].move)) - std::begin(MCTS_DIRECTIONS);
+			visitsPerMove[k] += arena[child].visits;
+			isLegal[k] = true;
+		}
+	}
+
+	char best = 0;
+	std::uint64_t bestVisits = 0;
+	for (size_t k = 0; k < MCTS_DIRECTION_COUNT; ++k)
+	{
+		if (isLegal[k] && (best == 0 || visitsPerMove[k] > bestVisits))
+		{
+			best = MCTS_DIRECTIONS[k];
+			bestVisits = visitsPerMove[k];
+		}
+	}
+
+	for (const auto& tree : m_trees)
+	{
+		tree->lastChanceNode = NodeArena::NO_NODE;
+		const NodeArena& arena = tree->arena;
+		for (std::uint32_t child = arena[tree->root].firstChild; child != NodeArena::NO_NODE; child = arena[child].nextSibling)
+		{
+			if (arena[child].move == static_cast<std::uint8_t>(best)) { tree->lastChanceNode = child; }
+		}
+	}
+
+	if (best == 0)
+	{
+		m_lastAfterstate.reset();
+		return 0;
+	}
+
+	m_lastAfterstate = board;
+	m_lastAfterstate->slide(best);
+	return best;
+}
+
+void MctsPolicy::newGame()
+{
+	for (const auto& tree : m_trees)
+	{
+		tree->arena.reset();
+		tree->root = NodeArena::NO_NODE;
+		tree->lastChanceNode = NodeArena::NO_NODE;
+		tree->valueMin = std::numeric_limits<double>::max();
+		tree->valueMax = std::numeric_limits<double>::lowest();
+	}
+	m_lastAfterstate.reset();
+}
+
+// Searchers are created on the first decision and pick the stored seed up then
+void MctsPolicy::reseed(std::uint64_t seed)
+{
+	m_seed = seed;
+	for (size_t t = 0; t < m_searchers.size(); ++t)
+	{
+		std::seed_seq streamSeed { m_seed, static_cast<std::uint64_t>(t) };
+		m_searchers[t].generator.seed(streamSeed);
+	}
+}
+
+std::uint64_t MctsPolicy::getIterations() const
+{
+	std::uint64_t iterations = 0;
+	for (const Searcher& searcher : m_searchers) { iterations += searcher.iterations; }
+	return iterations;
+}
+
+std::uint64_t MctsPolicy::getRootVisits() const
+{
+	std::uint64_t visits = 0;
+	for (const auto& tree : m_trees)
+	{
+		if (tree->root != NodeArena::NO_NODE) { visits += tree->arena[tree->root].visits; }
+	}
+	return visits;
+}
+
+std::uint64_t MctsPolicy::getReusedRootVisits() const
+{
+	return m_reusedRootVisits;
+}
+
+size_t MctsPolicy::getNodeCount() const
+{
+	size_t nodes = 0;
+	for (const auto& tree : m_trees) { nodes += tree->arena.size(); }
+	return nodes;
+}
+
+void MctsPolicy::prepareRoot(Tree& tree, const Board& board)
+{
+	std::uint32_t root = findReusableRoot(tree, board);
+
+	// Rather than run out mid-search, a half-full arena keeps only the reused subtree.
+	// A subtree that alone fills more than half is kept whole and copied again next time.
+	if (tree.arena.size() > tree.arena.capacity() / 2)
+	{
+		if (root != NodeArena::NO_NODE)
+		{
+			root = copySubtree(tree.arena, root, tree.spareArena);
+		}
+		tree.arena.swap(tree.spareArena);
+		tree.spareArena.reset();
+	}
+	if (root == NodeArena::NO_NODE) { root = tree.arena.allocate(); }
+
+	tree.root = root;
+	tree.lastChanceNode = NodeArena::NO_NODE;
+}
+
+// The new root is the child of the last chosen move that matches the spawn the game actually produced
+std::uint32_t MctsPolicy::findReusableRoot(const Tree& tree, const Board& board) const
+{
+	if (tree.lastChanceNode == NodeArena::NO_NODE || !m_lastAfterstate) { return NodeArena::NO_NODE; }
+
+	const Board& afterstate = *m_lastAfterstate;
+	if (afterstate.getBoardHeight() != board.getBoardHeight() || afterstate.getBoardWidth() != board.getBoardWidth())
+	{
+		return NodeArena::NO_NODE;
+	}
+
+	size_t spawnedCell = board.getBoardHeight() * board.getBoardWidth();
+	int spawnedValue = 0;
+	for (size_t i = 0; i < board.getBoardHeight(); ++i)
+	{
+		for (size_t j = 0; j < board.getBoardWidth(); ++j)
+		{
+			if (afterstate.getTile(i, j) == board.getTile(i, j)) { continue; }
+
+			// More than one difference, or an overwritten tile: this is not the position we planned for
+			if (afterstate.getTile(i, j) != 0 || spawnedValue != 0) { return NodeArena::NO_NODE; }
+			spawnedCell = i * board.getBoardWidth() + j;
+			spawnedValue = board.getTile(i, j);
+		}
+	}
+	if (spawnedValue == 0) { return NodeArena::NO_NODE; }
+
+	const NodeArena& arena = tree.arena;
+	for (std::uint32_t child = arena[tree.lastChanceNode].firstChild; child != NodeArena::NO_NODE; child = arena[child].nextSibling)
+	{
+		if (arena[child].move == spawnedCell && arena[child].tile == spawnedValue / 2) { return child; }
+	}
+	return NodeArena::NO_NODE;
+}
+
+void MctsPolicy::runHelper(std::stop_token stopToken, size_t searcher)
+{
+	// Tree parallelism shares the first tree; root parallelism gives each searcher its own
+	Tree& tree = *m_trees[m_trees.size() == 1 ? 0 : searcher];
+	for (;;)
+	{
+		m_decisionStart->arrive_and_wait();
+		if (stopToken.stop_requested()) { return; }
+
+		search(m_searchers[searcher], tree, *m_root, m_deadline);
+		m_decisionEnd->arrive_and_wait();
+	}
+}
+
+void MctsPolicy::search(Searcher& searcher, Tree& tree, const Board& root, std::chrono::steady_clock::time_point deadline)
+{
+	// Counted searches share one pool of iterations across threads and trees
+	const bool isTimed = m_settings.budget.count() > 0;
+	for (;;)
+	{
+		const bool isDone = isTimed
+			? std::chrono::steady_clock::now() >= deadline
+			: m_iterationTickets.fetch_add(1, std::memory_order_relaxed) >= m_settings.iterationsPerDecision;
+		if (isDone) { break; }
+
+		runIteration(searcher, tree, root);
+	}
+}
+
+void MctsPolicy::runIteration(Searcher& searcher, Tree& tree, const Board& root)
+{
+	NodeArena& arena = tree.arena;
+	Board& board = searcher.scratchBoards[SCRATCH_PATH];
+	board = root;
+
+	// Every node on the path carries a virtual loss until the rollout result is backed up,
+	// which steers other threads towards different branches meanwhile
+	const auto enter = [&searcher, &arena](std::uint32_t node)
+	{
+		arena[node].virtualLosses.fetch_add(1, std::memory_order_relaxed);
+		searcher.path.push_back(node);
+	};
+
+	searcher.path.clear();
+	enter(tree.root);
+
+	// Descend by UCT until a node is expanded or first reached, then roll out from there
+	std::uint32_t node = tree.root;
+	bool isLeaf = false;
+	while (!isLeaf)
+	{
+		if (arena[node].state.load(std::memory_order_acquire) != NODE_EXPANDED)
+		{
+			if (!expand(searcher, tree, node, board)) { break; }
+			isLeaf = true;
+		}
+
+		const std::uint32_t chanceNode = selectChild(tree, node);
+		if (chanceNode == NodeArena::NO_NODE) { break; }
+
+		board.slide(static_cast<char>(arena[chanceNode].move));
+		enter(chanceNode);
+
+		const size_t cell = board.spawnTile(searcher.generator());
+		const int value = board.getTile(cell / board.getBoardWidth(), cell % board.getBoardWidth());
+		node = findOrAddSpawnChild(tree, chanceNode, cell, value);
+		if (node == NodeArena::NO_NODE) { break; }
+
+		enter(node);
+		isLeaf |= arena[node].visits.load(std::memory_order_relaxed) == 0;
+	}
+
+	// Final scores rather than gains from the root keep statistics valid after the root moves on
+	const auto value = static_cast<double>(playRollout(searcher, board));
+	updateMinimum(tree.valueMin, value);
+	updateMaximum(tree.valueMax, value);
+	for (const std::uint32_t visited : searcher.path)
+	{
+		arena[visited].visits.fetch_add(1, std::memory_order_relaxed);
+		arena[visited].valueSum.fetch_add(value, std::memory_order_relaxed);
+		arena[visited].virtualLosses.fetch_sub(1, std::memory_order_relaxed);
+	}
+	++searcher.iterations;
+}
+
+// A node is expanded with every legal move or not at all: a child missing because the arena
+// ran out would never be searched from it. A node that cannot be expanded stays a leaf.
+bool MctsPolicy::expand(Searcher& searcher, Tree& tree, std::uint32_t node, const Board& board)
+{
+	NodeArena& arena = tree.arena;
+	if (arena.capacity() - arena.size() < MCTS_DIRECTION_COUNT) { return false; }
+
+	// Another thread is expanding this node: treat it as a leaf for now
+	std::uint8_t expected = NODE_UNEXPANDED;
+	if (!arena[node].state.compare_exchange_strong(expected, NODE_EXPANDING, std::memory_order_acquire)) { return false; }
+
+	std::array<char, MCTS_DIRECTION_COUNT> legalMoves {};
+	std::uint32_t legalMoveCount = 0;
+	Board& probe = searcher.scratchBoards[SCRATCH_PROBE];
+	for (const char direction : MCTS_DIRECTIONS)
+	{
+		probe = board;
+		if (probe.slide(direction)) { legalMoves[legalMoveCount++] = direction; }
+	}
+
+	// Other threads may have taken the last nodes since the check above
+	std::uint32_t firstChild = NodeArena::NO_NODE;
+	if (legalMoveCount > 0)
+	{
+		const std::uint32_t children = arena.allocate(legalMoveCount);
+		if (children == NodeArena::NO_NODE)
+		{
+			arena[node].state.store(NODE_UNEXPANDED, std::memory_order_release);
+			return false;
+		}
+		for (std::uint32_t k = 0; k < legalMoveCount; ++k)
+		{
+			arena[children + k].move = static_cast<std::uint8_t>(legalMoves[k]);
+			arena[children + k].nextSibling = (k + 1 < legalMoveCount) ? children + k + 1 : NodeArena::NO_NODE;
+		}
+		firstChild = children;
+	}
+
+	// A node without children is terminal; selectChild() then finds nothing to descend into
+	arena[node].firstChild.store(firstChild, std::memory_order_release);
+	arena[node].state.store(NODE_EXPANDED, std::memory_order_release);
+	return true;
+}
+
+std::uint32_t MctsPolicy::selectChild(const Tree& tree, std::uint32_t node) const
+{
+	const NodeArena& arena = tree.arena;
+
+	double valueMin = tree.valueMin.load(std::memory_order_relaxed);
+	double valueMax = tree.valueMax.load(std::memory_order_relaxed);
+	if (valueMin > valueMax) { valueMin = valueMax = 0.0; }
+	const double k_valueRange = std::max(valueMax - valueMin, 1.0);
+
+	const double k_parentVisits = arena[node].visits.load(std::memory_order_relaxed) + arena[node].virtualLosses.load(std::memory_order_relaxed);
+	const double k_logParentVisits = std::log(std::max(k_parentVisits, 1.0));
+
+	std::uint32_t best = NodeArena::NO_NODE;
+	double bestScore = std::numeric_limits<double>::lowest();
+	for (std::uint32_t child = arena[node].firstChild.load(std::memory_order_acquire); child != NodeArena::NO_NODE; child = arena[child].nextSibling)
+	{
+		const MctsNode& candidate = arena[child];
+		const std::uint32_t visits = candidate.visits.load(std::memory_order_relaxed);
+		const std::uint32_t virtualLosses = candidate.virtualLosses.load(std::memory_order_relaxed);
+		if (visits + virtualLosses == 0) { return child; }
+
+		// In-flight visits count as the worst outcome seen so far
+		const double effectiveVisits = static_cast<double>(visits) + virtualLosses;
+		const double mean = (candidate.valueSum.load(std::memory_order_relaxed) + virtualLosses * valueMin) / effectiveVisits;
+		const double score = (mean - valueMin) / k_valueRange
+			+ m_settings.explorationConstant * std::sqrt(k_logParentVisits / effectiveVisits);
+		if (score > bestScore)
+		{
+			bestScore = score;
+			best = child;
+		}
+	}
+	return best;
+}
+
+std::uint32_t MctsPolicy::findOrAddSpawnChild(Tree& tree, std::uint32_t chanceNode, size_t cellIndex, int value)
+{
+	NodeArena& arena = tree.arena;
+	const auto cell = static_cast<std::uint8_t>(cellIndex);
+	const auto tile = static_cast<std::uint8_t>(value / 2);
+
+	// Lock-free push onto the child list; when another thread publishes the same spawn
+	// first, its node wins and ours stays unused in the arena until the next reset
+	std::uint32_t created = NodeArena::NO_NODE;
+	std::uint32_t head = arena[chanceNode].firstChild.load(std::memory_order_acquire);
+	for (;;)
+	{
+		for (std::uint32_t child = head; child != NodeArena::NO_NODE; child = arena[child].nextSibling)
+		{
+			if (arena[child].move == cell && arena[child].tile == tile) { return child; }
+		}
+
+		if (created == NodeArena::NO_NODE)
+		{
+			created = arena.allocate();
+			if (created == NodeArena::NO_NODE) { return created; }
+
+			arena[created].move = cell;
+			arena[created].tile = tile;
+		}
+
+		arena[created].nextSibling = head;
+		if (arena[chanceNode].firstChild.compare_exchange_weak(head, created, std::memory_order_release, std::memory_order_acquire))
+		{
+			return created;
+		}
+	}
+}
+
+int MctsPolicy::playRollout(Searcher& searcher, Board& board)
+{
+	// The first legal direction of a shuffled order is uniform over the legal ones
+	std::array<char, MCTS_DIRECTION_COUNT> directions = std::to_array(MCTS_DIRECTIONS);
+	for (;;)
+	{
+		std::shuffle(directions.begin(), directions.end(), searcher.generator);
+		bool isMoved = false;
+		for (size_t k = 0; k < MCTS_DIRECTION_COUNT && !isMoved; ++k) { isMoved = board.slide(directions[k]); }
+		if (!isMoved) { return board.getScore(); }
+
+		board.spawnTile(searcher.generator());
+	}
+}
@@ -0,0 +1,148 @@
+#ifndef MCTS_POLICY_H
+#define MCTS_POLICY_H
+
+#include "Board.h"
+#include "Policy.h"
+
+#include <atomic>
+#include <barrier>
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <random>
+#include <stop_token>
+#include <thread>
+#include <vector>
+
+// Counters are atomic so that several threads can search one tree; links are
+// written before a node is published through its parent's firstChild or state.
+struct MctsNode
+{
+	std::atomic<double> valueSum = 0.0;
+	std::atomic<std::uint32_t> visits = 0;
+	std::atomic<std::uint32_t> virtualLosses = 0;	// Threads currently searching below this node
+	std::atomic<std::uint32_t> firstChild = 0;
+	std::uint32_t nextSibling = 0;
+	std::uint8_t move = 0;			// Chance nodes: direction that leads to them; decision nodes: spawned cell index
+	std::uint8_t tile = 0;			// Decision nodes: spawned tile value / 2
+	std::atomic<std::uint8_t> state = 0;
+};
+
+// Bump allocator for tree nodes: one block sized up front, handed out in order
+// and released all at once when a game ends. Index 0 is reserved as "no node".
+// allocate() may be called concurrently; reset() and swap() may not.
+class NodeArena
+{
+public:
+	explicit NodeArena(size_t capacity);
+
+public:
+	std::uint32_t allocate(std::uint32_t count = 1);		// First of count consecutive nodes, or NO_NODE for none of them
+	void reset();
+	void swap(NodeArena& other);
+	size_t size() const;
+	size_t capacity() const;
+	MctsNode& operator[](std::uint32_t index);
+	const MctsNode& operator[](std::uint32_t index) const;
+
+public:
+	static constexpr std::uint32_t NO_NODE = 0;
+
+private:
+	std::vector<MctsNode> m_nodes;
+	std::atomic<size_t> m_size = 1;
+};
+
+enum class MctsParallelism
+{
+	Tree,		// All threads share one tree, spread over branches by virtual loss
+	Root		// Every thread grows its own tree; root visit counts are summed at the end
+};
+
+struct MctsSettings
+{
+	size_t iterationsPerDecision = 2000;
+	std::chrono::microseconds budget { 0 };		// When set, iterations run until it expires instead of counting
+	double explorationConstant = 1.0;
+	size_t arenaCapacity = size_t{ 1 } << 20;	// Nodes per tree; each tree holds a second arena this size to compact into
+	size_t threadCount = 1;
+	MctsParallelism parallelism = MctsParallelism::Tree;
+	std::uint64_t seed = 0;
+};
+
+// UCT search with explicit chance nodes for the spawn step. Boards are not stored in
+// the tree: each iteration replays moves and spawns from the root onto a scratch board.
+// The subtree reached by the chosen move and the observed spawn is kept for the next decision;
+// once the arena is half full that subtree is copied into the spare arena and the two swap.
+// Searchers other than the caller's run on helper threads that live as long as the policy
+// and are released into each decision by a barrier.
+class MctsPolicy : public Policy
+{
+public:
+	explicit MctsPolicy(const MctsSettings& settings);
+	~MctsPolicy() override;
+	char chooseMove(const Board& board) override;
+	void newGame() override;
+	void reseed(std::uint64_t seed) override;
+
+public:
+	std::uint64_t getIterations() const;
+	std::uint64_t getRootVisits() const;		// Summed over the trees; includes visits kept from earlier decisions
+	std::uint64_t getReusedRootVisits() const;	// Root visits kept from earlier decisions when the last one started
+	size_t getNodeCount() const;
+
+private:
+	struct Tree
+	{
+		explicit Tree(size_t arenaCapacity);
+
+		NodeArena arena;
+		NodeArena spareArena;
+		std::uint32_t root = NodeArena::NO_NODE;
+		std::uint32_t lastChanceNode = NodeArena::NO_NODE;
+		std::atomic<double> valueMin = std::numeric_limits<double>::max();
+		std::atomic<double> valueMax = std::numeric_limits<double>::lowest();
+	};
+
+	struct alignas(64) Searcher
+	{
+		std::vector<Board> scratchBoards;		// Path replay and legality probe
+		std::vector<std::uint32_t> path;
+		std::mt19937_64 generator;
+		std::uint64_t iterations = 0;
+	};
+
+private:
+	void prepareRoot(Tree& tree, const Board& board);
+	std::uint32_t findReusableRoot(const Tree& tree, const Board& board) const;
+	void runHelper(std::stop_token stopToken, size_t searcher);
+	void search(Searcher& searcher, Tree& tree, const Board& root, std::chrono::steady_clock::time_point deadline);
+	void runIteration(Searcher& searcher, Tree& tree, const Board& root);
+	bool expand(Searcher& searcher, Tree& tree, std::uint32_t node, const Board& board);
+	std::uint32_t selectChild(const Tree& tree, std::uint32_t node) const;
+	std::uint32_t findOrAddSpawnChild(Tree& tree, std::uint32_t chanceNode, size_t cellIndex, int value);
+	int playRollout(Searcher& searcher, Board& board);
+
+private:
+	const MctsSettings m_settings;
+
+private:
+	std::vector<std::unique_ptr<Tree>> m_trees;
+	std::vector<Searcher> m_searchers;
+	std::uint64_t m_seed = 0;
+	std::uint64_t m_reusedRootVisits = 0;
+	std::optional<Board> m_lastAfterstate;
+	std::atomic<size_t> m_iterationTickets = 0;
+
+private:
+	// Set before the helpers cross m_decisionStart
+	const Board* m_root = nullptr;
+	std::chrono::steady_clock::time_point m_deadline;
+	std::optional<std::barrier<>> m_decisionStart;
+	std::optional<std::barrier<>> m_decisionEnd;
+	std::vector<std::jthread> m_helpers;			// Searchers 1 and up
+};
+
+#endif // MCTS_POLICY_H
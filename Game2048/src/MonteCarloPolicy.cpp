@@ -0,0 +1,193 @@
+#include "MonteCarloPolicy.h"
+
+#include <algorithm>
+#include <thread>
+
+namespace
+{
+	constexpr char ROLLOUT_DIRECTIONS[] = { 'w', 'a', 's', 'd' };
+	constexpr size_t ROLLOUT_DIRECTION_COUNT = std::size(ROLLOUT_DIRECTIONS);
+}
+
+MonteCarloPolicy::MonteCarloPolicy(const MonteCarloSettings& settings) :
+	m_settings(settings),
+	m_seed(settings.seed)
+{}
+
+// Helpers wake from the start barrier, see the stop request and leave; the jthreads join them
+MonteCarloPolicy::~MonteCarloPolicy()
+{
+	if (m_helpers.empty()) { return; }
+
+	for (std::jthread& helper : m_helpers) { helper.request_stop(); }
+	m_decisionStart->arrive_and_wait();
+	m_helpers.clear();
+}
+
+char MonteCarloPolicy::chooseMove(const Board& board)
+{
+	std::array<char, ROLLOUT_DIRECTION_COUNT> legalMoves {};
+	size_t legalMoveCount = 0;
+	for (const char direction : ROLLOUT_DIRECTIONS)
+	{
+		Board afterstate = board;
+		if (afterstate.slide(direction)) { legalMoves[legalMoveCount++] = direction; }
+	}
+	if (legalMoveCount < 2) { return legalMoveCount ? legalMoves.front() : char{ 0 }; }
+
+	if (m_workers.empty())
+	{
+		const size_t k_threadCount = std::max<size_t>(m_settings.threadCount, 1);
+		m_workers.reserve(k_threadCount);
+		for (size_t t = 0; t < k_threadCount; ++t)
+		{
+			// Independent stream per thread, reproducible from the policy seed
+			std::seed_seq streamSeed { m_seed, static_cast<std::uint64_t>(t) };
+			m_workers.push_back(Worker{ board, board, std::mt19937_64(streamSeed) });
+		}
+		if (k_threadCount > 1)
+		{
+			m_decisionStart.emplace(static_cast<std::ptrdiff_t>(k_threadCount));
+			m_decisionEnd.emplace(static_cast<std::ptrdiff_t>(k_threadCount));
+			m_helpers.reserve(k_threadCount - 1);
+			for (size_t t = 1; t < k_threadCount; ++t)
+			{
+				m_helpers.emplace_back([this, t](std::stop_token stopToken) { runHelper(stopToken, t); });
+			}
+		}
+	}
+
+	const auto deadline = std::chrono::steady_clock::now() + m_settings.budget;
+	const std::span<const char> moves(legalMoves.data(), legalMoveCount);
+	if (!m_helpers.empty())
+	{
+		m_root = &board;
+		m_moves = moves;
+		m_deadline = deadline;
+		m_decisionStart->arrive_and_wait();
+	}
+	runRollouts(m_workers.front(), board, moves, 0, deadline);
+	if (!m_helpers.empty()) { m_decisionEnd->arrive_and_wait(); }
+
+	std::array<double, ROLLOUT_DIRECTION_COUNT> scoreSums {};
+	std::array<size_t, ROLLOUT_DIRECTION_COUNT> rolloutCounts {};
+	for (const Worker& worker : m_workers)
+	{
+		for (size_t k = 0; k < legalMoveCount; ++k)
+		{
+			scoreSums[k] += worker.scoreSums[k];
+			rolloutCounts[k] += worker.rolloutCounts[k];
+		}
+		m_movesPlayed += worker.movesPlayed;
+	}
+
+	char bestMove = legalMoves.front();
+	double bestMean = -1.0;
+	for (size_t k = 0; k < legalMoveCount; ++k)
+	{
+		if (rolloutCounts[k] == 0) { continue; }
+
+		const double mean = scoreSums[k] / static_cast<double>(rolloutCounts[k]);
+		if (mean > bestMean)
+		{
+			bestMean = mean;
+			bestMove = legalMoves[k];
+		}
+	}
+	return bestMove;
+}
+
+// Workers are built on the first decision; until then the seed is only kept for them
+void MonteCarloPolicy::reseed(std::uint64_t seed)
+{
+	m_seed = seed;
+	for (size_t t = 0; t < m_workers.size(); ++t)
+	{
+		std::seed_seq streamSeed { m_seed, static_cast<std::uint64_t>(t) };
+		m_workers[t].generator.seed(streamSeed);
+	}
+}
+
+std::uint64_t MonteCarloPolicy::getMovesPlayed() const
+{
+	return m_movesPlayed;
+}
+
+void MonteCarloPolicy::runHelper(std::stop_token stopToken, size_t worker)
+{
+	for (;;)
+	{
+		m_decisionStart->arrive_and_wait();
+		if (stopToken.stop_requested()) { return; }
+
+		runRollouts(m_workers[worker], *m_root, m_moves, worker, m_deadline);
+		m_decisionEnd->arrive_and_wait();
+	}
+}
+
+void MonteCarloPolicy::runRollouts(Worker& worker, const Board& root, std::span<const char> moves, size_t firstRollout,
+	std::chrono::steady_clock::time_point deadline)
+{
+	worker.scoreSums.fill(0.0);
+	worker.rolloutCounts.fill(0);
+	worker.movesPlayed = 0;
+
+	// Rollouts are dealt round-robin over threads and then over root moves
+	const bool isTimed = m_settings.budget.count() > 0;
+	for (size_t rollout = firstRollout; ; rollout += m_workers.size())
+	{
+		if (isTimed ? std::chrono::steady_clock::now() >= deadline : rollout >= m_settings.rolloutsPerDecision) { break; }
+
+		const size_t moveIndex = rollout % moves.size();
+		worker.rolloutBoard = root;
+		worker.rolloutBoard.slide(moves[moveIndex]);
+
+		worker.scoreSums[moveIndex] += playRollout(worker) - root.getScore();
+		++worker.rolloutCounts[moveIndex];
+	}
+}
+
+int MonteCarloPolicy::playRollout(Worker& worker)
+{
+	do
+	{
+		worker.rolloutBoard.spawnTile(worker.generator());
+		++worker.movesPlayed;
+	} while (advanceRollout(worker));
+
+	return worker.rolloutBoard.getScore();
+}
+
+bool MonteCarloPolicy::advanceRollout(Worker& worker)
+{
+	Board& board = worker.rolloutBoard;
+
+	// A uniformly shuffled order makes the first legal direction in it uniform over the legal
+	// ones; a random starting point in a fixed cycle would favour those after an illegal one
+	std::array<char, ROLLOUT_DIRECTION_COUNT> directions = std::to_array(ROLLOUT_DIRECTIONS);
+	std::shuffle(directions.begin(), directions.end(), worker.generator);
+
+	if (m_settings.rolloutPolicy == RolloutPolicy::Random)
+	{
+		// A slide that moves nothing leaves the board untouched, so directions can simply be tried in turn
+		for (const char direction : directions)
+		{
+			if (board.slide(direction)) { return true; }
+		}
+		return false;
+	}
+
+	// Ties go to the first in the shuffled order, so they too are broken uniformly
+	char bestDirection = 0;
+	int bestScore = -1;
+	for (const char direction : directions)
+	{
+		worker.scratchBoard = board;
+		if (worker.scratchBoard.slide(direction) && worker.scratchBoard.getScore() > bestScore)
+		{
+			bestScore = worker.scratchBoard.getScore();
+			bestDirection = direction;
+		}
+	}
+	return bestDirection != 0 && board.slide(bestDirection);
+}
@@ -0,0 +1,84 @@
+#ifndef MONTE_CARLO_POLICY_H
+#define MONTE_CARLO_POLICY_H
+
+#include "Board.h"
+#include "Policy.h"
+
+#include <array>
+#include <barrier>
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <random>
+#include <span>
+#include <stop_token>
+#include <thread>
+#include <vector>
+
+enum class RolloutPolicy
+{
+	Random,
+	Greedy		// Plays the move with the largest immediate merge score
+};
+
+struct MonteCarloSettings
+{
+	size_t rolloutsPerDecision = 1000;
+	std::chrono::microseconds budget { 0 };		// When set, rollouts run until it expires instead of counting
+	size_t threadCount = 1;
+	RolloutPolicy rolloutPolicy = RolloutPolicy::Random;
+	std::uint64_t seed = 0;
+};
+
+// Scores every legal root move by the mean score gained in rollouts played to game over.
+// Each thread owns its boards and generator, so rollouts neither allocate nor share state.
+// Helper threads are started on the first decision and wait between decisions, so a move
+// costs two barrier crossings rather than starting and joining every thread.
+class MonteCarloPolicy : public Policy
+{
+public:
+	explicit MonteCarloPolicy(const MonteCarloSettings& settings);
+	~MonteCarloPolicy() override;
+	char chooseMove(const Board& board) override;
+	void reseed(std::uint64_t seed) override;
+
+public:
+	std::uint64_t getMovesPlayed() const;
+
+private:
+	struct alignas(64) Worker
+	{
+		Board rolloutBoard;
+		Board scratchBoard;
+		std::mt19937_64 generator;
+		std::array<double, 4> scoreSums {};
+		std::array<size_t, 4> rolloutCounts {};
+		std::uint64_t movesPlayed = 0;
+	};
+
+private:
+	void runRollouts(Worker& worker, const Board& root, std::span<const char> moves, size_t firstRollout,
+		std::chrono::steady_clock::time_point deadline);
+	void runHelper(std::stop_token stopToken, size_t worker);
+	int playRollout(Worker& worker);
+	bool advanceRollout(Worker& worker);
+
+private:
+	const MonteCarloSettings m_settings;
+
+private:
+	std::vector<Worker> m_workers;
+	std::uint64_t m_seed = 0;
+	std::uint64_t m_movesPlayed = 0;
+
+private:
+	// The decision the helpers work on; written before they cross m_decisionStart
+	const Board* m_root = nullptr;
+	std::span<const char> m_moves;
+	std::chrono::steady_clock::time_point m_deadline;
+	std::optional<std::barrier<>> m_decisionStart;
+	std::optional<std::barrier<>> m_decisionEnd;
+	std::vector<std::jthread> m_helpers;			// Workers 1 and up; the calling thread is worker 0
+};
+
+#endif // MONTE_CARLO_POLICY_H
@@ -0,0 +1,531 @@
+#include "NTupleNetwork.h"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cassert>
+#include <cmath>
+#include <limits>
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+namespace
+{
+	constexpr char NTUPLE_DIRECTIONS[] = { 'w', 'a', 's', 'd' };
+	constexpr size_t NTUPLE_RECTANGLE_SYMMETRIES = 4;
+	constexpr size_t NTUPLE_SQUARE_SYMMETRIES = 8;
+	constexpr size_t QUANTIZED_GATHER_PADDING = 3;		// A 32-bit gather at the last int8 weight reads three past it
+
+	using BatchLanes = std::array<PackedBoard, NTupleLayout::BATCH_LANES>;
+	using BatchIndices = std::array<std::array<std::int32_t, NTupleLayout::BATCH_LANES>, NTupleLayout::BATCH_FEATURE_BLOCK>;
+
+	// Weights are read while other training threads write them; relaxed atomics
+	// compile to plain loads and stores but keep the races well-defined
+	float loadWeight(const float& weight)
+	{
+		return std::atomic_ref<float>(const_cast<float&>(weight)).load(std::memory_order_relaxed);
+	}
+
+	// Bit 0 mirrors columns, bit 1 mirrors rows, bit 2 transposes (square boards only)
+	size_t mapCell(size_t cell, size_t symmetry, size_t height, size_t width)
+	{
+		size_t row = cell / width;
+		size_t column = cell % width;
+		if (symmetry & 4) { std::swap(row, column); }
+		if (symmetry & 1) { column = width - 1 - column; }
+		if (symmetry & 2) { row = height - 1 - row; }
+		return row * width + column;
+	}
+
+	// A short last batch repeats its final board in the spare lanes; their values are dropped
+	size_t fillBatchLanes(std::span<const PackedBoard> boards, size_t first, BatchLanes& lanes)
+	{
+		const size_t k_count = std::min(lanes.size(), boards.size() - first);
+		for (size_t lane = 0; lane < lanes.size(); ++lane) { lanes[lane] = boards[first + std::min(lane, k_count - 1)]; }
+		return k_count;
+	}
+
+	// Weight indices of a block of features in every lane, stage offsets included. Every
+	// lookup of the block is prefetched before the first gather, so their misses overlap.
+	template <typename Weight_t>
+	void computeBatchIndices(const NTupleLayout& layout, const BatchLanes& lanes, size_t firstFeature, size_t featureCount,
+		const Weight_t* weights, BatchIndices& indices)
+	{
+		const std::vector<NTupleLayout::Feature>& features = layout.getFeatures();
+		for (size_t lane = 0; lane < lanes.size(); ++lane)
+		{
+			const size_t k_stageOffset = layout.getStageOffset(lanes[lane]);
+			for (size_t f = 0; f < featureCount; ++f)
+			{
+				const size_t k_index = k_stageOffset + layout.weightIndex(features[firstFeature + f], lanes[lane]);
+				indices[f][lane] = static_cast<std::int32_t>(k_index);
+#ifdef __AVX2__
+				_mm_prefetch(reinterpret_cast<const char*>(weights + k_index), _MM_HINT_T0);
+#else
+				static_cast<void>(weights);
+#endif
+			}
+		}
+	}
+}
+
+void PositionEvaluator::evaluateBatch(std::span<const PackedBoard> boards, std::span<float> values) const
+{
+	assert(values.size() >= boards.size() && "Batch needs one value per board");
+	for (size_t k = 0; k < boards.size(); ++k) { values[k] = evaluate(boards[k]); }
+}
+
+NTupleLayout::NTupleLayout(size_t height, size_t width, const std::vector<NTuple_t>& tuples, const std::vector<int>& stageStarts) :
+	m_height(height),
+	m_width(width),
+	m_tuples(tuples),
+	m_stageStarts(stageStarts)
+{
+	assert(height * width <= PackedBoard::MAX_CELLS && "Board is too large for packed evaluation");
+	assert(std::is_sorted(stageStarts.begin(), stageStarts.end()) && "Stages must start at increasing tiles");
+
+	for (size_t exponent = 0; exponent < m_stageOfExponent.size(); ++exponent)
+	{
+		const auto k_startedStages = std::count_if(stageStarts.begin(), stageStarts.end(),
+			[exponent](int start) { return static_cast<int>(exponent) >= start; });
+		m_stageOfExponent[exponent] = static_cast<std::uint8_t>(k_startedStages);
+	}
+
+	const size_t k_symmetries = (height == width) ? NTUPLE_SQUARE_SYMMETRIES : NTUPLE_RECTANGLE_SYMMETRIES;
+	m_tableOffsets.push_back(0);
+	for (size_t table = 0; table < tuples.size(); ++table)
+	{
+		const NTuple_t& tuple = tuples[table];
+		assert(!tuple.empty() && tuple.size() <= MAX_TUPLE_SIZE && "Unsupported tuple size");
+
+		for (size_t symmetry = 0; symmetry < k_symmetries; ++symmetry)
+		{
+			Feature feature;
+			feature.size = static_cast<std::uint8_t>(tuple.size());
+			feature.table = table;
+			feature.tableOffset = m_tableOffsets.back();
+			for (size_t k = 0; k < tuple.size(); ++k)
+			{
+				assert(tuple[k] < height * width && "Tuple cell is outside of the board");
+				feature.cells[k] = static_cast<std::uint8_t>(mapCell(tuple[k], symmetry, height, width));
+			}
+			m_features.push_back(feature);
+		}
+		m_tableOffsets.push_back(m_tableOffsets.back() + (size_t{ 1 } << (BITS_PER_CELL * tuple.size())));
+	}
+
+	// Layouts with more features than bits fall back to revisiting all of them
+	m_cellFeatures.assign(height * width, m_features.size() > MAX_INCREMENTAL_FEATURES ? ~std::uint64_t{ 0 } : 0);
+	for (size_t f = 0; f < m_features.size() && m_features.size() <= MAX_INCREMENTAL_FEATURES; ++f)
+	{
+		for (size_t k = 0; k < m_features[f].size; ++k) { m_cellFeatures[m_features[f].cells[k]] |= std::uint64_t{ 1 } << f; }
+	}
+}
+
+const std::vector<NTupleLayout::Feature>& NTupleLayout::getFeatures() const
+{
+	return m_features;
+}
+
+std::uint64_t NTupleLayout::getCellFeatures(std::uint64_t cells) const
+{
+	std::uint64_t features = 0;
+	for (; cells != 0; cells &= cells - 1)
+	{
+		const auto cell = static_cast<size_t>(std::countr_zero(cells));
+		if (cell < m_cellFeatures.size()) { features |= m_cellFeatures[cell]; }
+	}
+	return features;
+}
+
+const std::vector<NTuple_t>& NTupleLayout::getTuples() const
+{
+	return m_tuples;
+}
+
+size_t NTupleLayout::getTableOffset(size_t table) const
+{
+	return m_tableOffsets[table];
+}
+
+size_t NTupleLayout::getTableSize(size_t table) const
+{
+	return m_tableOffsets[table + 1] - m_tableOffsets[table];
+}
+
+const std::vector<int>& NTupleLayout::getStageStarts() const
+{
+	return m_stageStarts;
+}
+
+size_t NTupleLayout::getStageCount() const
+{
+	return m_stageStarts.size() + 1;
+}
+
+size_t NTupleLayout::getStageWeightCount() const
+{
+	return m_tableOffsets.back();
+}
+
+size_t NTupleLayout::getWeightCount() const
+{
+	return getStageCount() * getStageWeightCount();
+}
+
+size_t NTupleLayout::getBoardHeight() const
+{
+	return m_height;
+}
+
+size_t NTupleLayout::getBoardWidth() const
+{
+	return m_width;
+}
+
+NTupleNetwork::NTupleNetwork(size_t height, size_t width, const std::vector<NTuple_t>& tuples, const std::vector<int>& stageStarts) :
+	m_layout(height, width, tuples, stageStarts),
+	m_weights(m_layout.getWeightCount(), 0.0f)
+{}
+
+float NTupleNetwork::evaluate(const PackedBoard& board) const
+{
+	const float* const k_weights = m_weights.data() + m_layout.getStageOffset(board);
+	float value = 0.0f;
+	for (const NTupleLayout::Feature& feature : m_layout.getFeatures())
+	{
+		value += loadWeight(k_weights[m_layout.weightIndex(feature, board)]);
+	}
+	return value;
+}
+
+float NTupleNetwork::evaluate(const Board& board) const
+{
+	return evaluate(packBoard(board));
+}
+
+void NTupleNetwork::evaluateBatch(std::span<const PackedBoard> boards, std::span<float> values) const
+{
+	assert(values.size() >= boards.size() && "Batch needs one value per board");
+	assert(m_weights.size() <= static_cast<size_t>(std::numeric_limits<std::int32_t>::max()) && "Gather indices are 32-bit");
+
+	const std::vector<NTupleLayout::Feature>& features = m_layout.getFeatures();
+	BatchLanes lanes;
+	BatchIndices indices;
+	for (size_t first = 0; first < boards.size(); first += NTupleLayout::BATCH_LANES)
+	{
+		const size_t k_count = fillBatchLanes(boards, first, lanes);
+		alignas(32) std::array<float, NTupleLayout::BATCH_LANES> sums {};
+#ifdef __AVX2__
+		__m256 sum = _mm256_setzero_ps();
+#endif
+		for (size_t block = 0; block < features.size(); block += NTupleLayout::BATCH_FEATURE_BLOCK)
+		{
+			const size_t k_blockSize = std::min(NTupleLayout::BATCH_FEATURE_BLOCK, features.size() - block);
+			computeBatchIndices(m_layout, lanes, block, k_blockSize, m_weights.data(), indices);
+			for (size_t f = 0; f < k_blockSize; ++f)
+			{
+#ifdef __AVX2__
+				const __m256i k_indices = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(indices[f].data()));
+				sum = _mm256_add_ps(sum, _mm256_i32gather_ps(m_weights.data(), k_indices, sizeof(float)));
+#else
+				for (size_t lane = 0; lane < lanes.size(); ++lane) { sums[lane] += m_weights[indices[f][lane]]; }
+#endif
+			}
+		}
+#ifdef __AVX2__
+		_mm256_store_ps(sums.data(), sum);
+#endif
+		std::copy_n(sums.begin(), k_count, values.begin() + first);
+	}
+}
+
+void NTupleNetwork::update(const PackedBoard& board, float delta)
+{
+	// Load and store rather than fetch_add: under Hogwild training a concurrent update
+	// to the same weight may be lost, which costs far less than a locked add per lookup
+	float* const k_weights = m_weights.data() + m_layout.getStageOffset(board);
+	for (const NTupleLayout::Feature& feature : m_layout.getFeatures())
+	{
+		std::atomic_ref<float> weight(k_weights[m_layout.weightIndex(feature, board)]);
+		weight.store(weight.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+	}
+}
+
+void NTupleNetwork::collectContributions(const PackedBoard& board, NTupleContributions& contributions) const
+{
+	const std::vector<NTupleLayout::Feature>& features = m_layout.getFeatures();
+	const float* const k_weights = m_weights.data() + m_layout.getStageOffset(board);
+	contributions.features.resize(features.size());
+	contributions.total = 0.0f;
+	contributions.stage = m_layout.getStage(board);
+	for (size_t f = 0; f < features.size(); ++f)
+	{
+		contributions.features[f] = loadWeight(k_weights[m_layout.weightIndex(features[f], board)]);
+		contributions.total += contributions.features[f];
+	}
+}
+
+// base must come from a position that differs from board only in changedCells
+float NTupleNetwork::evaluateChanged(const PackedBoard& board, const NTupleContributions& base, std::uint64_t changedCells) const
+{
+	// A merge into a new largest tile can switch the whole weight set
+	const std::vector<NTupleLayout::Feature>& features = m_layout.getFeatures();
+	if (features.size() > NTupleLayout::MAX_INCREMENTAL_FEATURES || m_layout.getStage(board) != base.stage) { return evaluate(board); }
+
+	const float* const k_weights = m_weights.data() + m_layout.getStageOffset(board);
+	float value = base.total;
+	for (std::uint64_t affected = m_layout.getCellFeatures(changedCells); affected != 0; affected &= affected - 1)
+	{
+		const auto f = static_cast<size_t>(std::countr_zero(affected));
+		value += loadWeight(k_weights[m_layout.weightIndex(features[f], board)]) - base.features[f];
+	}
+	return value;
+}
+
+const NTupleLayout& NTupleNetwork::getLayout() const
+{
+	return m_layout;
+}
+
+std::span<const float> NTupleNetwork::getWeights() const
+{
+	return m_weights;
+}
+
+void NTupleNetwork::setWeights(std::span<const float> weights)
+{
+	assert(weights.size() == m_weights.size() && "Weights are for another layout");
+	std::copy(weights.begin(), weights.end(), m_weights.begin());
+}
+
+size_t NTupleNetwork::getFeatureCount() const
+{
+	return m_layout.getFeatures().size();
+}
+
+size_t NTupleNetwork::getWeightCount() const
+{
+	return m_weights.size();
+}
+
+size_t NTupleNetwork::getBoardHeight() const
+{
+	return m_layout.getBoardHeight();
+}
+
+size_t NTupleNetwork::getBoardWidth() const
+{
+	return m_layout.getBoardWidth();
+}
+
+std::vector<NTuple_t> NTupleNetwork::defaultTuples(size_t height, size_t width)
+{
+	// Straight and rectangular 6-tuples of the strongest published 4x4 networks
+	if (height == 4 && width == 4)
+	{
+		return {
+			{ 0, 1, 2, 3, 4, 5 },
+			{ 4, 5, 6, 7, 8, 9 },
+			{ 0, 1, 2, 4, 5, 6 },
+			{ 4, 5, 6, 8, 9, 10 }
+		};
+	}
+
+	// The 5x4 game board has no transpose symmetry, so its middle row and
+	// the long edge get tuples of their own
+	if (height == 5 && width == 4)
+	{
+		return {
+			{ 0, 1, 2, 3, 4, 5 },
+			{ 4, 5, 6, 7, 8, 9 },
+			{ 8, 9, 10, 11, 12, 13 },
+			{ 0, 1, 2, 4, 5, 6 },
+			{ 4, 5, 6, 8, 9, 10 },
+			{ 0, 1, 4, 5, 8, 9 }
+		};
+	}
+
+	// Other sizes: the leading cells of every row and column in one half of the board,
+	// the mirror symmetries sample the other half
+	std::vector<NTuple_t> tuples;
+	for (size_t i = 0; i < (height + 1) / 2; ++i)
+	{
+		NTuple_t& row = tuples.emplace_back();
+		for (size_t j = 0; j < std::min(width, MAX_TUPLE_SIZE); ++j) { row.push_back(i * width + j); }
+	}
+	for (size_t j = 0; j < (width + 1) / 2; ++j)
+	{
+		NTuple_t& column = tuples.emplace_back();
+		for (size_t i = 0; i < std::min(height, MAX_TUPLE_SIZE); ++i) { column.push_back(i * width + j); }
+	}
+	return tuples;
+}
+
+template <typename Weight_t>
+QuantizedNTupleNetwork<Weight_t>::QuantizedNTupleNetwork(const NTupleNetwork& network) :
+	m_layout(network.getLayout()),
+	m_tableScales(m_layout.getStageCount() * m_layout.getTuples().size(), 1.0f),
+	m_weights(m_layout.getWeightCount() + QUANTIZED_GATHER_PADDING)
+{
+	const std::span<const float> weights = network.getWeights();
+	const size_t k_tuples = m_layout.getTuples().size();
+	for (size_t scale = 0; scale < m_tableScales.size(); ++scale)
+	{
+		const size_t k_table = scale % k_tuples;
+		const size_t k_tableBegin = (scale / k_tuples) * m_layout.getStageWeightCount() + m_layout.getTableOffset(k_table);
+		const size_t k_tableEnd = k_tableBegin + m_layout.getTableSize(k_table);
+
+		float largest = 0.0f;
+		for (size_t k = k_tableBegin; k < k_tableEnd; ++k) { largest = std::max(largest, std::abs(weights[k])); }
+		if (largest > 0.0f) { m_tableScales[scale] = largest / static_cast<float>(std::numeric_limits<Weight_t>::max()); }
+
+		for (size_t k = k_tableBegin; k < k_tableEnd; ++k)
+		{
+			m_weights[k] = static_cast<Weight_t>(std::lround(weights[k] / m_tableScales[scale]));
+		}
+	}
+}
+
+template <typename Weight_t>
+float QuantizedNTupleNetwork<Weight_t>::evaluate(const PackedBoard& board) const
+{
+	const Weight_t* const k_weights = m_weights.data() + m_layout.getStageOffset(board);
+	const float* const k_scales = m_tableScales.data() + m_layout.getStage(board) * m_layout.getTuples().size();
+	float value = 0.0f;
+	for (const NTupleLayout::Feature& feature : m_layout.getFeatures())
+	{
+		value += k_scales[feature.table] * static_cast<float>(k_weights[m_layout.weightIndex(feature, board)]);
+	}
+	return value;
+}
+
+// Sums each table's integer weights before scaling them, so every lane needs one float
+// multiply per table rather than per feature; the last bits may differ from evaluate()
+template <typename Weight_t>
+void QuantizedNTupleNetwork<Weight_t>::evaluateBatch(std::span<const PackedBoard> boards, std::span<float> values) const
+{
+	assert(values.size() >= boards.size() && "Batch needs one value per board");
+	assert(m_weights.size() <= static_cast<size_t>(std::numeric_limits<std::int32_t>::max()) && "Gather indices are 32-bit");
+
+	const std::vector<NTupleLayout::Feature>& features = m_layout.getFeatures();
+	const size_t k_tuples = m_layout.getTuples().size();
+	BatchLanes lanes;
+	BatchIndices indices;
+	for (size_t first = 0; first < boards.size(); first += NTupleLayout::BATCH_LANES)
+	{
+		const size_t k_count = fillBatchLanes(boards, first, lanes);
+		alignas(32) std::array<std::int32_t, NTupleLayout::BATCH_LANES> scaleOffsets {};
+		for (size_t lane = 0; lane < lanes.size(); ++lane)
+		{
+			scaleOffsets[lane] = static_cast<std::int32_t>(m_layout.getStage(lanes[lane]) * k_tuples);
+		}
+
+		alignas(32) std::array<float, NTupleLayout::BATCH_LANES> sums {};
+#ifdef __AVX2__
+		// Gathered words hold the weight in their low bytes; shifting up and back sign-extends it
+		constexpr int k_extendShift = 32 - 8 * static_cast<int>(sizeof(Weight_t));
+		const __m256i k_scaleOffsets = _mm256_load_si256(reinterpret_cast<const __m256i*>(scaleOffsets.data()));
+		__m256 sum = _mm256_setzero_ps();
+		__m256i tableSum = _mm256_setzero_si256();
+		const auto addTable = [&](size_t table)
+		{
+			const __m256i k_scaleIndices = _mm256_add_epi32(k_scaleOffsets, _mm256_set1_epi32(static_cast<int>(table)));
+			const __m256 k_scales = _mm256_i32gather_ps(m_tableScales.data(), k_scaleIndices, sizeof(float));
+			sum = _mm256_add_ps(sum, _mm256_mul_ps(k_scales, _mm256_cvtepi32_ps(tableSum)));
+			tableSum = _mm256_setzero_si256();
+		};
+#else
+		std::array<std::int32_t, NTupleLayout::BATCH_LANES> tableSums {};
+		const auto addTable = [&](size_t table)
+		{
+			for (size_t lane = 0; lane < lanes.size(); ++lane)
+			{
+				sums[lane] += m_tableScales[scaleOffsets[lane] + table] * static_cast<float>(tableSums[lane]);
+				tableSums[lane] = 0;
+			}
+		};
+#endif
+		for (size_t block = 0; block < features.size(); block += NTupleLayout::BATCH_FEATURE_BLOCK)
+		{
+			const size_t k_blockSize = std::min(NTupleLayout::BATCH_FEATURE_BLOCK, features.size() - block);
+			computeBatchIndices(m_layout, lanes, block, k_blockSize, m_weights.data(), indices);
+			for (size_t f = 0; f < k_blockSize; ++f)
+			{
+				// Features of one table are consecutive
+				const size_t k_table = features[block + f].table;
+				if (block + f > 0 && k_table != features[block + f - 1].table) { addTable(features[block + f - 1].table); }
+#ifdef __AVX2__
+				const __m256i k_indices = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(indices[f].data()));
+				const __m256i k_words = _mm256_i32gather_epi32(reinterpret_cast<const int*>(m_weights.data()), k_indices, sizeof(Weight_t));
+				tableSum = _mm256_add_epi32(tableSum, _mm256_srai_epi32(_mm256_slli_epi32(k_words, k_extendShift), k_extendShift));
+#else
+				for (size_t lane = 0; lane < lanes.size(); ++lane) { tableSums[lane] += m_weights[indices[f][lane]]; }
+#endif
+			}
+		}
+		if (!features.empty()) { addTable(features.back().table); }
+#ifdef __AVX2__
+		_mm256_store_ps(sums.data(), sum);
+#endif
+		std::copy_n(sums.begin(), k_count, values.begin() + first);
+	}
+}
+
+template <typename Weight_t>
+const NTupleLayout& QuantizedNTupleNetwork<Weight_t>::getLayout() const
+{
+	return m_layout;
+}
+
+template <typename Weight_t>
+std::span<const Weight_t> QuantizedNTupleNetwork<Weight_t>::getWeights() const
+{
+	return std::span<const Weight_t>(m_weights).first(getWeightCount());
+}
+
+template <typename Weight_t>
+std::span<const float> QuantizedNTupleNetwork<Weight_t>::getTableScales() const
+{
+	return m_tableScales;
+}
+
+template <typename Weight_t>
+size_t QuantizedNTupleNetwork<Weight_t>::getWeightCount() const
+{
+	return m_layout.getWeightCount();
+}
+
+template class QuantizedNTupleNetwork<std::int16_t>;
+template class QuantizedNTupleNetwork<std::int8_t>;
+
+NTupleMove findGreedyMove(const PositionEvaluator& evaluator, const Board& board, Board& scratch)
+{
+	NTupleMove best;
+	for (const char direction : NTUPLE_DIRECTIONS)
+	{
+		scratch = board;
+		if (!scratch.slide(direction)) { continue; }
+
+		const int reward = scratch.getScore() - board.getScore();
+		const PackedBoard afterstate = packBoard(scratch);
+		const float value = static_cast<float>(reward) + evaluator.evaluate(afterstate);
+		if (best.direction == 0 || value > best.value)
+		{
+			best = NTupleMove{ direction, reward, value, afterstate };
+		}
+	}
+	return best;
+}
+
+NTuplePolicy::NTuplePolicy(const PositionEvaluator& evaluator) :
+	m_evaluator(evaluator)
+{}
+
+char NTuplePolicy::chooseMove(const Board& board)
+{
+	if (!m_scratch) { m_scratch.emplace(board); }
+	return findGreedyMove(m_evaluator, board, *m_scratch).direction;
+}
@@ -0,0 +1,200 @@
+#ifndef NTUPLE_NETWORK_H
+#define NTUPLE_NETWORK_H
+
+#include "Board.h"
+#include "PackedBoard.h"
+#include "Policy.h"
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <vector>
+
+using NTuple_t = std::vector<size_t>;	// Row-major cell indices
+
+struct NTupleMove
+{
+	char direction = 0;		// 0 when the board has no legal move
+	int reward = 0;			// Score gained by the slide
+	float value = 0.0f;		// Reward plus the afterstate value
+	PackedBoard afterstate;
+};
+
+// Learned value of a position, for code that plays with any network variant
+class PositionEvaluator
+{
+public:
+	virtual ~PositionEvaluator() = default;
+	virtual float evaluate(const PackedBoard& board) const = 0;
+
+	// values must hold one entry per board. Variants that override this look up many
+	// boards at once, so that their cache misses overlap instead of queueing one by one.
+	virtual void evaluateBatch(std::span<const PackedBoard> boards, std::span<float> values) const;
+};
+
+// scratch must match the board's size; it is left holding the last probed afterstate
+NTupleMove findGreedyMove(const PositionEvaluator& evaluator, const Board& board, Board& scratch);
+
+// Where every tuple image looks its weight up. Each tuple is sampled at every symmetry
+// of the board (four for rectangles, eight for squares) and all of its images, the
+// features, share one table of 16^size weights indexed by the exponents under their cells.
+// Optional stages give every range of the board's largest tile a whole set of tables:
+// stage s + 1 starts when the largest exponent reaches stageStarts[s].
+class NTupleLayout
+{
+public:
+	static constexpr size_t MAX_TUPLE_SIZE = 6;
+	static constexpr size_t BITS_PER_CELL = 4;
+	static constexpr size_t MAX_INCREMENTAL_FEATURES = 64;
+	static constexpr size_t BATCH_LANES = 8;				// Boards per gather
+	static constexpr size_t BATCH_FEATURE_BLOCK = 16;		// Features whose lookups are prefetched together
+
+	struct Feature
+	{
+		std::array<std::uint8_t, MAX_TUPLE_SIZE> cells {};
+		std::uint8_t size = 0;
+		size_t table = 0;
+		size_t tableOffset = 0;
+	};
+
+public:
+	NTupleLayout(size_t height, size_t width, const std::vector<NTuple_t>& tuples, const std::vector<int>& stageStarts = {});
+
+public:
+	size_t weightIndex(const Feature& feature, const PackedBoard& board) const
+	{
+		size_t index = 0;
+		for (size_t k = 0; k < feature.size; ++k)
+		{
+			index |= static_cast<size_t>(board.getExponent(feature.cells[k])) << (BITS_PER_CELL * k);
+		}
+		return feature.tableOffset + index;
+	}
+
+	size_t getStage(const PackedBoard& board) const
+	{
+		return m_stageOfExponent[board.maxExponent];
+	}
+
+	size_t getStageOffset(const PackedBoard& board) const
+	{
+		return getStage(board) * getStageWeightCount();
+	}
+
+public:
+	const std::vector<Feature>& getFeatures() const;
+	std::uint64_t getCellFeatures(std::uint64_t cells) const;	// Bit per feature that reads any of the cells
+	const std::vector<NTuple_t>& getTuples() const;
+	size_t getTableOffset(size_t table) const;
+	size_t getTableSize(size_t table) const;
+	const std::vector<int>& getStageStarts() const;
+	size_t getStageCount() const;
+	size_t getStageWeightCount() const;
+	size_t getWeightCount() const;		// Over all stages
+	size_t getBoardHeight() const;
+	size_t getBoardWidth() const;
+
+private:
+	const size_t m_height;
+	const size_t m_width;
+	const std::vector<NTuple_t> m_tuples;
+	const std::vector<int> m_stageStarts;
+
+private:
+	std::array<std::uint8_t, PackedBoard::MAX_EXPONENT + 1> m_stageOfExponent {};
+	std::vector<Feature> m_features;
+	std::vector<std::uint64_t> m_cellFeatures;
+	std::vector<size_t> m_tableOffsets;		// Plus one past the last table
+};
+
+// Weight each feature of one position reads, so that a position differing from it
+// in a few cells is valued by revisiting only the features over those cells
+struct NTupleContributions
+{
+	std::vector<float> features;
+	float total = 0.0f;
+	size_t stage = 0;
+};
+
+// Value function that sums one float weight per feature of its layout.
+// evaluate() and update() may run concurrently from several threads; evaluateBatch()
+// reads the weights with plain gathers and is meant for inference only.
+class NTupleNetwork : public PositionEvaluator
+{
+public:
+	NTupleNetwork(size_t height, size_t width, const std::vector<NTuple_t>& tuples, const std::vector<int>& stageStarts = {});
+
+public:
+	float evaluate(const PackedBoard& board) const override;
+	float evaluate(const Board& board) const;
+	void evaluateBatch(std::span<const PackedBoard> boards, std::span<float> values) const override;
+	void update(const PackedBoard& board, float delta);		// Adds delta to every weight the board looks up
+	void setWeights(std::span<const float> weights);		// One per weight of the layout, as getWeights() returns them
+	void collectContributions(const PackedBoard& board, NTupleContributions& contributions) const;
+	float evaluateChanged(const PackedBoard& board, const NTupleContributions& base, std::uint64_t changedCells) const;
+
+public:
+	const NTupleLayout& getLayout() const;
+	std::span<const float> getWeights() const;
+	size_t getFeatureCount() const;
+	size_t getWeightCount() const;
+	size_t getBoardHeight() const;
+	size_t getBoardWidth() const;
+
+public:
+	static std::vector<NTuple_t> defaultTuples(size_t height, size_t width);
+
+public:
+	static constexpr size_t MAX_TUPLE_SIZE = NTupleLayout::MAX_TUPLE_SIZE;
+
+private:
+	const NTupleLayout m_layout;
+
+private:
+	std::vector<float> m_weights;
+};
+
+// Inference-only copy of a trained network. Each tuple's table is scaled so that its
+// largest weight maps to the top of Weight_t, which cuts the memory the lookups touch
+// to a half (int16) or a quarter (int8) at the cost of rounding every weight.
+template <typename Weight_t>
+class QuantizedNTupleNetwork : public PositionEvaluator
+{
+public:
+	explicit QuantizedNTupleNetwork(const NTupleNetwork& network);
+	float evaluate(const PackedBoard& board) const override;
+	void evaluateBatch(std::span<const PackedBoard> boards, std::span<float> values) const override;
+
+public:
+	const NTupleLayout& getLayout() const;
+	std::span<const Weight_t> getWeights() const;
+	std::span<const float> getTableScales() const;		// Per stage, then per tuple
+	size_t getWeightCount() const;
+
+private:
+	const NTupleLayout m_layout;
+
+private:
+	std::vector<float> m_tableScales;
+	std::vector<Weight_t> m_weights;		// Padded, so that a 32-bit gather of the last weight stays inside
+};
+
+using Int16NTupleNetwork = QuantizedNTupleNetwork<std::int16_t>;
+using Int8NTupleNetwork = QuantizedNTupleNetwork<std::int8_t>;
+
+// Plays the move with the best reward plus learned afterstate value
+class NTuplePolicy : public Policy
+{
+public:
+	explicit NTuplePolicy(const PositionEvaluator& evaluator);
+	char chooseMove(const Board& board) override;
+
+private:
+	const PositionEvaluator& m_evaluator;
+
+private:
+	std::optional<Board> m_scratch;
+};
+
+#endif // NTUPLE_NETWORK_H
@@ -0,0 +1,32 @@
+#include "PackedBoard.h"
+
+#include <algorithm>
+#include <cassert>
+
+// Overwriting the largest tile with a smaller one leaves maxExponent as it was
+void PackedBoard::setExponent(size_t cell, int exponent)
+{
+	assert(cell < MAX_CELLS && "Cell is outside of a packed board");
+
+	const size_t shift = 4 * (cell % CELLS_PER_WORD);
+	const auto nibble = static_cast<std::uint64_t>(std::clamp(exponent, 0, MAX_EXPONENT));
+	std::uint64_t& word = nibbles[cell / CELLS_PER_WORD];
+	word = (word & ~(std::uint64_t{ 0xF } << shift)) | (nibble << shift);
+	maxExponent = std::max(maxExponent, static_cast<std::uint8_t>(nibble));
+}
+
+PackedBoard packBoard(const Board& board)
+{
+	assert(board.getBoardHeight() * board.getBoardWidth() <= PackedBoard::MAX_CELLS && "Board is too large to pack");
+
+	PackedBoard packed;
+	size_t cell = 0;
+	for (size_t i = 0; i < board.getBoardHeight(); ++i)
+	{
+		for (size_t j = 0; j < board.getBoardWidth(); ++j, ++cell)
+		{
+			packed.setExponent(cell, getTileExponent(board.getTile(i, j)));
+		}
+	}
+	return packed;
+}
@@ -0,0 +1,45 @@
+#ifndef PACKED_BOARD_H
+#define PACKED_BOARD_H
+
+#include "Board.h"
+
+#include <array>
+#include <bit>
+#include <cstdint>
+
+// Tiles are 0 or powers of two; an empty cell has exponent 0
+inline int getTileExponent(int tile)
+{
+	return tile > 0 ? std::bit_width(static_cast<unsigned>(tile)) - 1 : 0;
+}
+
+inline int getExponentTile(int exponent)
+{
+	return exponent > 0 ? 1 << exponent : 0;
+}
+
+// Tile exponents stored four bits per cell in row-major order, for boards of up to 32 cells.
+// Exponents saturate at MAX_EXPONENT, so tiles above 32768 all read back as 32768.
+// maxExponent tracks the largest exponent written, so game stage lookups need no scan.
+struct PackedBoard
+{
+	std::array<std::uint64_t, 2> nibbles {};
+	std::uint8_t maxExponent = 0;
+
+	int getExponent(size_t cell) const
+	{
+		return static_cast<int>((nibbles[cell / CELLS_PER_WORD] >> (4 * (cell % CELLS_PER_WORD))) & MAX_EXPONENT);
+	}
+
+	void setExponent(size_t cell, int exponent);
+
+	friend bool operator==(const PackedBoard& lhs, const PackedBoard& rhs) = default;
+
+	static constexpr size_t CELLS_PER_WORD = 16;
+	static constexpr size_t MAX_CELLS = 32;
+	static constexpr int MAX_EXPONENT = 15;
+};
+
+PackedBoard packBoard(const Board& board);
+
+#endif // PACKED_BOARD_H
@@ -0,0 +1,28 @@
+#include "Policy.h"
+
+#include <algorithm>
+#include <array>
+
+RandomPolicy::RandomPolicy(std::uint64_t seed) :
+	m_generator(seed)
+{}
+
+char RandomPolicy::chooseMove(const Board& board)
+{
+	std::array<char, 4> directions = { 'w', 'a', 's', 'd' };
+	std::shuffle(directions.begin(), directions.end(), m_generator);
+
+	// Kept between calls: a failed slide leaves the board unchanged, so one copy serves all four tries
+	if (!m_scratch) { m_scratch.emplace(board); }
+	*m_scratch = board;
+	for (const char direction : directions)
+	{
+		if (m_scratch->slide(direction)) { return direction; }
+	}
+	return 0;
+}
+
+void RandomPolicy::reseed(std::uint64_t seed)
+{
+	m_generator.seed(seed);
+}
@@ -0,0 +1,32 @@
+#ifndef POLICY_H
+#define POLICY_H
+
+#include "Board.h"
+
+#include <cstdint>
+#include <optional>
+#include <random>
+
+// Supplies moves in place of the keyboard; returns 0 when it has no move to offer
+class Policy
+{
+public:
+	virtual ~Policy() = default;
+	virtual char chooseMove(const Board& board) = 0;
+	virtual void newGame() {}
+	virtual void reseed(std::uint64_t) {}		// Restarts the policy's random stream; deterministic policies ignore it
+};
+
+class RandomPolicy : public Policy
+{
+public:
+	explicit RandomPolicy(std::uint64_t seed);
+	char chooseMove(const Board& board) override;
+	void reseed(std::uint64_t seed) override;
+
+private:
+	std::mt19937_64 m_generator;
+	std::optional<Board> m_scratch;
+};
+
+#endif // POLICY_H
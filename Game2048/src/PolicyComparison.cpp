@@ -0,0 +1,169 @@
+#include "PolicyComparison.h"
+#include "Random.h"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <thread>
+#include <utility>
+
+namespace
+{
+	constexpr std::uint64_t COMPARISON_POLICY_STREAM_A = ~std::uint64_t{ 0 };		// Never a game index
+	constexpr std::uint64_t COMPARISON_POLICY_STREAM_B = ~std::uint64_t{ 1 };
+
+	// Inverse of the standard normal distribution function, by bisection on erfc
+	double normalQuantile(double probability)
+	{
+		double low = -40.0;
+		double high = 40.0;
+		for (int k = 0; k < 200; ++k)
+		{
+			const double middle = 0.5 * (low + high);
+			if (0.5 * std::erfc(-middle / std::sqrt(2.0)) < probability) { low = middle; }
+			else { high = middle; }
+		}
+		return 0.5 * (low + high);
+	}
+
+	double sampleVariance(double sum, double squareSum, std::uint64_t count)
+	{
+		if (count < 2) { return 0.0; }
+		const double k_count = static_cast<double>(count);
+		return std::max(0.0, (squareSum - sum * sum / k_count) / (k_count - 1.0));
+	}
+}
+
+void WideSum::add(std::uint64_t value)
+{
+	low += value;
+	high += (low < value) ? 1 : 0;
+}
+
+void WideSum::merge(const WideSum& other)
+{
+	add(other.low);
+	high += other.high;
+}
+
+double WideSum::toDouble() const
+{
+	return std::ldexp(static_cast<double>(high), 64) + static_cast<double>(low);
+}
+
+// Scores are non-negative and below 2^31, so each square and squared difference fits in 64 bits
+void ComparisonSums::add(int scoreA, int scoreB)
+{
+	const auto k_scoreA = static_cast<std::uint64_t>(scoreA);
+	const auto k_scoreB = static_cast<std::uint64_t>(scoreB);
+	const std::int64_t k_difference = std::int64_t{ scoreA } - scoreB;
+	++games;
+	scoreSumA += k_scoreA;
+	scoreSumB += k_scoreB;
+	differenceSum += k_difference;
+	squareSumA.add(k_scoreA * k_scoreA);
+	squareSumB.add(k_scoreB * k_scoreB);
+	differenceSquareSum.add(static_cast<std::uint64_t>(k_difference * k_difference));
+}
+
+void ComparisonSums::merge(const ComparisonSums& other)
+{
+	games += other.games;
+	scoreSumA += other.scoreSumA;
+	scoreSumB += other.scoreSumB;
+	differenceSum += other.differenceSum;
+	squareSumA.merge(other.squareSumA);
+	squareSumB.merge(other.squareSumB);
+	differenceSquareSum.merge(other.differenceSquareSum);
+}
+
+PolicyComparison::PolicyComparison(const ComparisonSettings& settings, PolicyFactory makePolicyA, PolicyFactory makePolicyB) :
+	m_settings(settings),
+	m_makePolicyA(std::move(makePolicyA)),
+	m_makePolicyB(std::move(makePolicyB)),
+	m_emptyBoard(Board::makeEmpty(settings.winValue, settings.boardHeight, settings.boardWidth)),
+	m_workerSums(std::max<size_t>(settings.threadCount, 1))
+{
+	assert(settings.chunkSize > 0 && settings.gamesPerLook > 0 && "Chunks and looks need at least one game");
+}
+
+// Looks end at fixed game counts and the sums are exact, so a run stops at the same game
+// with the same result however many threads play it
+ComparisonResult PolicyComparison::run()
+{
+	const size_t k_workers = m_workerSums.size();
+	const size_t k_firstLook = std::min(m_settings.minGames, m_settings.maxGames);
+	const size_t k_plannedLooks = 1 + (m_settings.maxGames - k_firstLook + m_settings.gamesPerLook - 1) / m_settings.gamesPerLook;
+	const double k_z = normalQuantile(1.0 - (1.0 - m_settings.confidence) / (2.0 * static_cast<double>(k_plannedLooks)));
+
+	ComparisonSums sums;
+	ComparisonResult result;
+	const auto start = std::chrono::steady_clock::now();
+	size_t looks = 0;
+	for (size_t firstGame = 0; firstGame < m_settings.maxGames;)
+	{
+		const size_t k_endGame = (looks == 0) ? std::max<size_t>(k_firstLook, 1) : std::min(m_settings.maxGames, firstGame + m_settings.gamesPerLook);
+		WorkStealingRanges chunks(k_workers, (k_endGame - firstGame + m_settings.chunkSize - 1) / m_settings.chunkSize);
+		{
+			std::vector<std::jthread> threads;
+			threads.reserve(k_workers);
+			for (size_t t = 0; t < k_workers; ++t) { threads.emplace_back(&PolicyComparison::runWorker, this, t, std::ref(chunks), firstGame, k_endGame); }
+		}
+		for (const WorkerSums& workerSums : m_workerSums) { sums.merge(workerSums.sums); }
+		firstGame = k_endGame;
+		++looks;
+
+		result = summarise(sums, k_z);
+		if (result.isSignificant) { break; }
+	}
+
+	result.looks = looks;
+	result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	return result;
+}
+
+// Policies are built on the worker's own thread; each is reseeded per game, so neither
+// carries anything from one game into the next
+void PolicyComparison::runWorker(size_t worker, WorkStealingRanges& chunks, size_t firstGame, size_t endGame)
+{
+	Board board = m_emptyBoard;
+	const std::unique_ptr<Policy> policyA = m_makePolicyA(randomBitsAt(m_settings.seed, COMPARISON_POLICY_STREAM_A, worker));
+	const std::unique_ptr<Policy> policyB = m_makePolicyB(randomBitsAt(m_settings.seed, COMPARISON_POLICY_STREAM_B, worker));
+	ComparisonSums sums;
+	for (std::optional<size_t> chunk = chunks.next(worker); chunk; chunk = chunks.next(worker))
+	{
+		const size_t k_endGame = std::min(endGame, firstGame + (*chunk + 1) * m_settings.chunkSize);
+		for (size_t game = firstGame + *chunk * m_settings.chunkSize; game < k_endGame; ++game)
+		{
+			playSeededGame(*policyA, board, m_settings.seed, game);
+			const int k_scoreA = board.getScore();
+			playSeededGame(*policyB, board, m_settings.seed, game);
+			sums.add(k_scoreA, board.getScore());
+		}
+	}
+	m_workerSums[worker].sums = sums;
+}
+
+ComparisonResult PolicyComparison::summarise(const ComparisonSums& sums, double z) const
+{
+	ComparisonResult result;
+	result.games = sums.games;
+	if (sums.games == 0) { return result; }
+
+	const double k_games = static_cast<double>(sums.games);
+	result.meanScoreA = static_cast<double>(sums.scoreSumA) / k_games;
+	result.meanScoreB = static_cast<double>(sums.scoreSumB) / k_games;
+	result.meanDifference = static_cast<double>(sums.differenceSum) / k_games;
+
+	const double k_differenceVariance = sampleVariance(static_cast<double>(sums.differenceSum), sums.differenceSquareSum.toDouble(), sums.games);
+	const double k_unpairedVariance = sampleVariance(static_cast<double>(sums.scoreSumA), sums.squareSumA.toDouble(), sums.games)
+		+ sampleVariance(static_cast<double>(sums.scoreSumB), sums.squareSumB.toDouble(), sums.games);
+	result.standardError = std::sqrt(k_differenceVariance / k_games);
+	result.intervalLow = result.meanDifference - z * result.standardError;
+	result.intervalHigh = result.meanDifference + z * result.standardError;
+	result.varianceReduction = (k_differenceVariance > 0.0) ? k_unpairedVariance / k_differenceVariance : 0.0;
+	result.isSignificant = sums.games >= 2 && (result.intervalLow > 0.0 || result.intervalHigh < 0.0);
+	return result;
+}
@@ -0,0 +1,101 @@
+#ifndef POLICY_COMPARISON_H
+#define POLICY_COMPARISON_H
+
+#include "Simulator.h"
+#include "WorkStealing.h"
+
+#include <cstdint>
+#include <vector>
+
+struct ComparisonSettings
+{
+	size_t maxGames = 100000;			// Games per policy if the difference never becomes significant
+	size_t minGames = 1000;				// Games per policy before the first look
+	size_t gamesPerLook = 1000;			// Games per policy between looks
+	double confidence = 0.95;			// Holds across all planned looks together
+	int boardHeight = 5;
+	int boardWidth = 4;
+	int winValue = 2048;
+	std::uint64_t seed = 0;
+	size_t threadCount = 1;
+	size_t chunkSize = 16;
+};
+
+// Unsigned 128-bit total of 64-bit values, for sums of squared scores: a single square
+// can reach 2^62, and MSVC has no __int128
+struct WideSum
+{
+	std::uint64_t low = 0;
+	std::uint64_t high = 0;
+
+	void add(std::uint64_t value);
+	void merge(const WideSum& other);
+	double toDouble() const;
+};
+
+// Sums over pairs of games, one per policy on the same spawn stream. Scores are integers
+// and every sum is kept in integers wide enough for it, so the sums are exact and the same
+// whatever order the threads add games in.
+struct ComparisonSums
+{
+	std::uint64_t games = 0;
+	std::uint64_t scoreSumA = 0;
+	std::uint64_t scoreSumB = 0;
+	std::int64_t differenceSum = 0;
+	WideSum squareSumA;
+	WideSum squareSumB;
+	WideSum differenceSquareSum;
+
+	void add(int scoreA, int scoreB);
+	void merge(const ComparisonSums& other);
+};
+
+struct ComparisonResult
+{
+	std::uint64_t games = 0;			// Per policy
+	size_t looks = 0;
+	double meanScoreA = 0.0;
+	double meanScoreB = 0.0;
+	double meanDifference = 0.0;		// A minus B
+	double standardError = 0.0;			// Of the mean paired difference
+	double intervalLow = 0.0;
+	double intervalHigh = 0.0;
+	double varianceReduction = 0.0;		// Games unpaired runs would need per paired game for the same error; 0 when no pair differs
+	bool isSignificant = false;			// The interval excludes zero
+	double seconds = 0.0;
+};
+
+// Common random numbers: game g of policy A and game g of policy B draw their spawns from
+// the same randomBitsAt(seed, g, turn) stream, so both face the same luck until their moves
+// part ways; varianceReduction reports how much the pairing saved. Games run in looks of gamesPerLook
+// pairs; after each, the interval of the mean difference is checked and the run stops as
+// soon as it excludes zero. The interval's width is Bonferroni-corrected for every
+// planned look, so stopping early does not overstate the confidence.
+class PolicyComparison
+{
+public:
+	PolicyComparison(const ComparisonSettings& settings, PolicyFactory makePolicyA, PolicyFactory makePolicyB);
+
+public:
+	ComparisonResult run();
+
+private:
+	void runWorker(size_t worker, WorkStealingRanges& chunks, size_t firstGame, size_t endGame);
+	ComparisonResult summarise(const ComparisonSums& sums, double z) const;
+
+private:
+	const ComparisonSettings m_settings;
+	const PolicyFactory m_makePolicyA;
+	const PolicyFactory m_makePolicyB;
+	const Board m_emptyBoard;
+
+private:
+	struct alignas(64) WorkerSums
+	{
+		ComparisonSums sums;
+	};
+
+	std::vector<WorkerSums> m_workerSums;		// Of the current look
+};
+
+#endif // POLICY_COMPARISON_H
@@ -0,0 +1,22 @@
+#ifndef RANDOM_H
+#define RANDOM_H
+
+#include <cstdint>
+
+// Counter-based random bits: a stateless function of (seed, game, turn) rather than a
+// generator's position, so any game's spawns can be regenerated on their own, by any
+// thread and in any order. Built from the SplitMix64 finaliser.
+inline std::uint64_t mixBits(std::uint64_t bits)
+{
+	bits = (bits ^ (bits >> 30)) * 0xBF58476D1CE4E5B9ull;
+	bits = (bits ^ (bits >> 27)) * 0x94D049BB133111EBull;
+	return bits ^ (bits >> 31);
+}
+
+inline std::uint64_t randomBitsAt(std::uint64_t seed, std::uint64_t game, std::uint64_t turn)
+{
+	constexpr std::uint64_t k_golden = 0x9E3779B97F4A7C15ull;
+	return mixBits(mixBits(seed ^ mixBits(game * k_golden + 1)) + turn * k_golden);
+}
+
+#endif // RANDOM_H
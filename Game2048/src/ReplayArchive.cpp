@@ -0,0 +1,300 @@
+#include "ReplayArchive.h"
+#include "PackedBoard.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <string_view>
+
+namespace
+{
+	constexpr std::array<char, 8> REPLAY_INDEX_MAGIC = { '2', '0', '4', '8', 'I', 'D', 'X', '\0' };
+	constexpr std::uint32_t REPLAY_INDEX_VERSION = 1;
+	constexpr size_t REPLAY_INDEX_ALIGNMENT = 8;
+	constexpr std::string_view REPLAY_INDEX_EXTENSION = ".idx";
+
+	static_assert(sizeof(ReplayIndexHeader) == 64, "Replay index header must have no padding");
+	static_assert(sizeof(ReplayIndexEntry) == 32, "Replay index entry must have no padding");
+
+	size_t alignSection(size_t offset)
+	{
+		return (offset + REPLAY_INDEX_ALIGNMENT - 1) / REPLAY_INDEX_ALIGNMENT * REPLAY_INDEX_ALIGNMENT;
+	}
+
+	size_t getSnapshotCount(std::uint32_t turnCount, size_t snapshotInterval)
+	{
+		return 1 + turnCount / snapshotInterval;
+	}
+
+	void writeSnapshot(const Board& board, std::byte* snapshot)
+	{
+		const std::int32_t k_score = board.getScore();
+		std::memcpy(snapshot, &k_score, sizeof(k_score));
+		std::byte* exponents = snapshot + sizeof(k_score);
+		for (size_t i = 0; i < board.getBoardHeight(); ++i)
+		{
+			for (size_t j = 0; j < board.getBoardWidth(); ++j)
+			{
+				*exponents++ = static_cast<std::byte>(getTileExponent(board.getTile(i, j)));
+			}
+		}
+	}
+
+	void readSnapshot(const std::byte* snapshot, Board& board)
+	{
+		std::int32_t score = 0;
+		std::memcpy(&score, snapshot, sizeof(score));
+		board.setScore(score);
+		const std::byte* exponents = snapshot + sizeof(score);
+		for (size_t i = 0; i < board.getBoardHeight(); ++i)
+		{
+			for (size_t j = 0; j < board.getBoardWidth(); ++j)
+			{
+				board.setTile(i, j, getExponentTile(std::to_integer<int>(*exponents++)));
+			}
+		}
+	}
+
+	// Structural replay only: a slide that moves nothing is taken as recorded, since
+	// judging legality is the verifier's job and the index must cover every game
+	void applyTurn(Board& board, const RecordedTurn& turn)
+	{
+		const size_t k_width = board.getBoardWidth();
+		board.slide(turn.direction);
+		board.setTile(turn.spawn.cell / k_width, turn.spawn.cell % k_width, turn.spawn.tile);
+	}
+}
+
+std::unique_ptr<ReplayArchive> ReplayArchive::open(const std::string& recordPath, size_t snapshotInterval)
+{
+	MappedFile records(recordPath);
+	if (!records.isOpen() || records.getBytes().size() < sizeof(GameRecordFileHeader) || snapshotInterval == 0) { return nullptr; }
+
+	GameRecordFileHeader header;
+	std::memcpy(&header, records.getBytes().data(), sizeof(header));
+	if (!isValidGameRecordFileHeader(header)) { return nullptr; }
+
+	std::unique_ptr<ReplayArchive> archive(new ReplayArchive(std::move(records), header, snapshotInterval));
+	const std::string indexPath = recordPath + std::string(REPLAY_INDEX_EXTENSION);
+	if (!archive->loadIndex(indexPath) && !archive->buildIndex(indexPath)) { return nullptr; }
+	return archive;
+}
+
+ReplayArchive::ReplayArchive(MappedFile records, const GameRecordFileHeader& header, size_t snapshotInterval) :
+	m_records(std::move(records)),
+	m_header(header),
+	m_cells(size_t{ header.boardHeight } * header.boardWidth),
+	m_snapshotInterval(snapshotInterval),
+	m_snapshotBytes(alignSection(sizeof(std::int32_t) + m_cells))
+{
+}
+
+std::optional<size_t> ReplayArchive::findGame(std::uint64_t game) const
+{
+	const auto it = std::lower_bound(m_entries.begin(), m_entries.end(), game,
+		[](const ReplayIndexEntry& entry, std::uint64_t value) { return entry.game < value; });
+	if (it == m_entries.end() || it->game != game) { return std::nullopt; }
+	return static_cast<size_t>(it - m_entries.begin());
+}
+
+bool ReplayArchive::loadPosition(size_t entry, size_t turn, Board& board) const
+{
+	if (entry >= m_entries.size() || turn > m_entries[entry].turnCount) { return false; }
+	if (board.getBoardHeight() != m_header.boardHeight || board.getBoardWidth() != m_header.boardWidth) { return false; }
+
+	const ReplayIndexEntry& k_entry = m_entries[entry];
+	const size_t k_snapshot = turn / m_snapshotInterval;
+	readSnapshot(m_snapshots.data() + (k_entry.firstSnapshot + k_snapshot) * m_snapshotBytes, board);
+
+	const auto* codes = reinterpret_cast<const unsigned char*>(getGameCodes(k_entry).data());
+	for (size_t t = k_snapshot * m_snapshotInterval; t < turn; ++t)
+	{
+		applyTurn(board, decodeTurn(readTurnCode(codes + (m_header.openingSpawns + t) * m_header.bytesPerTurn, m_header.bytesPerTurn)));
+	}
+	return true;
+}
+
+bool ReplayArchive::readGame(size_t entry, GameRecord& record) const
+{
+	if (entry >= m_entries.size()) { return false; }
+
+	const ReplayIndexEntry& k_entry = m_entries[entry];
+	const auto* codes = reinterpret_cast<const unsigned char*>(getGameCodes(k_entry).data());
+	record.game = k_entry.game;
+	record.finalScore = k_entry.finalScore;
+	record.openingSpawns.resize(m_header.openingSpawns);
+	record.turns.resize(k_entry.turnCount);
+	for (size_t k = 0; k < record.openingSpawns.size(); ++k)
+	{
+		record.openingSpawns[k] = decodeTurn(readTurnCode(codes + k * m_header.bytesPerTurn, m_header.bytesPerTurn)).spawn;
+	}
+	for (size_t t = 0; t < record.turns.size(); ++t)
+	{
+		record.turns[t] = decodeTurn(readTurnCode(codes + (m_header.openingSpawns + t) * m_header.bytesPerTurn, m_header.bytesPerTurn));
+	}
+	return true;
+}
+
+Board ReplayArchive::makeEmptyBoard() const
+{
+	return Board::makeEmpty(m_header.winValue, static_cast<int>(m_header.boardHeight), static_cast<int>(m_header.boardWidth));
+}
+
+const GameRecordFileHeader& ReplayArchive::getHeader() const
+{
+	return m_header;
+}
+
+std::span<const ReplayIndexEntry> ReplayArchive::getEntries() const
+{
+	return m_entries;
+}
+
+size_t ReplayArchive::getSnapshotInterval() const
+{
+	return m_snapshotInterval;
+}
+
+// Everything a seek indexes with is checked here, so a stale or damaged index is
+// rebuilt instead of read out of bounds
+bool ReplayArchive::loadIndex(const std::string& indexPath)
+{
+	MappedFile indexFile(indexPath);
+	if (!indexFile.isOpen() || indexFile.getBytes().size() < sizeof(ReplayIndexHeader)) { return false; }
+
+	const std::span<const std::byte> k_bytes = indexFile.getBytes();
+	ReplayIndexHeader header;
+	std::memcpy(&header, k_bytes.data(), sizeof(header));
+	if (header.magic != REPLAY_INDEX_MAGIC || header.version != REPLAY_INDEX_VERSION
+		|| header.snapshotInterval != m_snapshotInterval || header.snapshotBytes != m_snapshotBytes
+		|| header.recordFileSize != m_records.getBytes().size()) { return false; }
+	if (header.entriesOffset % REPLAY_INDEX_ALIGNMENT != 0 || header.snapshotsOffset % REPLAY_INDEX_ALIGNMENT != 0) { return false; }
+	if (header.entriesOffset < sizeof(header) || header.entriesOffset > k_bytes.size() || header.gameCount > (k_bytes.size() - header.entriesOffset) / sizeof(ReplayIndexEntry)) { return false; }
+	if (header.snapshotsOffset < header.entriesOffset + header.gameCount * sizeof(ReplayIndexEntry)
+		|| header.snapshotsOffset > k_bytes.size() || header.snapshotCount > (k_bytes.size() - header.snapshotsOffset) / m_snapshotBytes) { return false; }
+
+	const std::span<const ReplayIndexEntry> entries(reinterpret_cast<const ReplayIndexEntry*>(k_bytes.data() + header.entriesOffset), header.gameCount);
+	for (size_t e = 0; e < entries.size(); ++e)
+	{
+		const ReplayIndexEntry& entry = entries[e];
+		const std::uint64_t k_codeBytes = (std::uint64_t{ m_header.openingSpawns } + entry.turnCount) * m_header.bytesPerTurn;
+		if (entry.recordOffset + sizeof(GameRecordHeader) + k_codeBytes > m_records.getBytes().size()) { return false; }
+		if (entry.firstSnapshot + getSnapshotCount(entry.turnCount, m_snapshotInterval) > header.snapshotCount) { return false; }
+		if (e > 0 && entries[e - 1].game >= entry.game) { return false; }
+	}
+
+	m_indexFile = std::move(indexFile);
+	m_entries = entries;
+	m_snapshots = k_bytes.subspan(header.snapshotsOffset, header.snapshotCount * m_snapshotBytes);
+	return true;
+}
+
+// The first pass finds the whole games: a damaged or truncated tail ends the index at the
+// last of them, as it ends GameRecordReader. The second replays them and streams every
+// snapshot to a temporary file, which is renamed and then mapped like a loaded index, so
+// only the entries are held in memory and a reader never maps half an index.
+bool ReplayArchive::buildIndex(const std::string& indexPath)
+{
+	const std::span<const std::byte> k_records = m_records.getBytes();
+	std::vector<ReplayIndexEntry> entries;
+	std::uint64_t snapshotCount = 0;
+
+	size_t offset = sizeof(GameRecordFileHeader);
+	while (k_records.size() - offset >= sizeof(GameRecordHeader))
+	{
+		GameRecordHeader gameHeader;
+		std::memcpy(&gameHeader, k_records.data() + offset, sizeof(gameHeader));
+		const std::uint64_t k_codeBytes = (std::uint64_t{ m_header.openingSpawns } + gameHeader.turnCount) * m_header.bytesPerTurn;
+		if (k_codeBytes > k_records.size() - offset - sizeof(gameHeader)) { break; }
+
+		const auto* codes = reinterpret_cast<const unsigned char*>(k_records.data() + offset + sizeof(gameHeader));
+		bool isValid = true;
+		for (size_t k = 0; k < m_header.openingSpawns + size_t{ gameHeader.turnCount } && isValid; ++k)
+		{
+			isValid = decodeTurn(readTurnCode(codes + k * m_header.bytesPerTurn, m_header.bytesPerTurn)).spawn.cell < m_cells;
+		}
+		if (!isValid) { break; }
+
+		ReplayIndexEntry entry;
+		entry.recordOffset = offset;
+		entry.game = gameHeader.game;
+		entry.firstSnapshot = snapshotCount;
+		entry.turnCount = gameHeader.turnCount;
+		entry.finalScore = gameHeader.finalScore;
+		entries.push_back(entry);
+
+		snapshotCount += getSnapshotCount(gameHeader.turnCount, m_snapshotInterval);
+		offset += sizeof(gameHeader) + static_cast<size_t>(k_codeBytes);
+	}
+
+	ReplayIndexHeader header;
+	header.magic = REPLAY_INDEX_MAGIC;
+	header.version = REPLAY_INDEX_VERSION;
+	header.snapshotInterval = static_cast<std::uint32_t>(m_snapshotInterval);
+	header.snapshotBytes = static_cast<std::uint32_t>(m_snapshotBytes);
+	header.recordFileSize = k_records.size();
+	header.gameCount = entries.size();
+	header.snapshotCount = snapshotCount;
+	header.entriesOffset = alignSection(sizeof(header));
+	header.snapshotsOffset = alignSection(header.entriesOffset + entries.size() * sizeof(ReplayIndexEntry));
+
+	const std::string temporaryPath = indexPath + ".tmp";
+	std::FILE* file = std::fopen(temporaryPath.c_str(), "wb");
+	if (!file) { return false; }
+
+	// Snapshots follow the record order the entries are still in
+	bool isWritten = std::fseek(file, static_cast<long>(header.snapshotsOffset), SEEK_SET) == 0;
+	std::vector<std::byte> snapshot(m_snapshotBytes, std::byte{ 0 });
+	Board board = makeEmptyBoard();
+	for (const ReplayIndexEntry& entry : entries)
+	{
+		const auto* codes = reinterpret_cast<const unsigned char*>(getGameCodes(entry).data());
+		board.clear();
+
+		// Without opening spawns the empty board is turn 0's snapshot
+		if (m_header.openingSpawns == 0)
+		{
+			writeSnapshot(board, snapshot.data());
+			isWritten = isWritten && std::fwrite(snapshot.data(), m_snapshotBytes, 1, file) == 1;
+		}
+		for (size_t k = 0; k < m_header.openingSpawns + size_t{ entry.turnCount } && isWritten; ++k)
+		{
+			const RecordedTurn turn = decodeTurn(readTurnCode(codes + k * m_header.bytesPerTurn, m_header.bytesPerTurn));
+			if (k < m_header.openingSpawns) { board.setTile(turn.spawn.cell / m_header.boardWidth, turn.spawn.cell % m_header.boardWidth, turn.spawn.tile); }
+			else { applyTurn(board, turn); }
+
+			if (k + 1 >= m_header.openingSpawns && (k + 1 - m_header.openingSpawns) % m_snapshotInterval == 0)
+			{
+				writeSnapshot(board, snapshot.data());
+				isWritten = std::fwrite(snapshot.data(), m_snapshotBytes, 1, file) == 1;
+			}
+		}
+	}
+
+	// Workers write their games in the order they claim them; lookups want them by index
+	std::sort(entries.begin(), entries.end(), [](const ReplayIndexEntry& lhs, const ReplayIndexEntry& rhs) { return lhs.game < rhs.game; });
+	const bool isUnique = std::adjacent_find(entries.begin(), entries.end(),
+		[](const ReplayIndexEntry& lhs, const ReplayIndexEntry& rhs) { return lhs.game == rhs.game; }) == entries.end();
+
+	isWritten = isWritten && isUnique && std::fseek(file, 0, SEEK_SET) == 0
+		&& std::fwrite(&header, sizeof(header), 1, file) == 1
+		&& std::fseek(file, static_cast<long>(header.entriesOffset), SEEK_SET) == 0
+		&& std::fwrite(entries.data(), sizeof(ReplayIndexEntry), entries.size(), file) == entries.size();
+	isWritten = (std::fclose(file) == 0) && isWritten;
+
+	std::error_code error;
+	if (isWritten) { std::filesystem::rename(temporaryPath, indexPath, error); }
+	if (!isWritten || error)
+	{
+		std::filesystem::remove(temporaryPath, error);
+		return false;
+	}
+	return loadIndex(indexPath);
+}
+
+std::span<const std::byte> ReplayArchive::getGameCodes(const ReplayIndexEntry& entry) const
+{
+	const size_t k_codes = m_header.openingSpawns + size_t{ entry.turnCount };
+	return m_records.getBytes().subspan(static_cast<size_t>(entry.recordOffset) + sizeof(GameRecordHeader), k_codes * m_header.bytesPerTurn);
+}
@@ -0,0 +1,87 @@
+#ifndef REPLAY_ARCHIVE_H
+#define REPLAY_ARCHIVE_H
+
+#include "Board.h"
+#include "GameRecord.h"
+#include "MappedFile.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+// Starts the sidecar index of a record file: one entry per game, sorted by game index,
+// then a board snapshot every snapshotInterval turns of every game. A snapshot is the
+// score as an int32 followed by one tile exponent byte per cell, padded to 8 bytes.
+struct ReplayIndexHeader
+{
+	std::array<char, 8> magic {};
+	std::uint32_t version = 0;
+	std::uint32_t snapshotInterval = 0;
+	std::uint32_t snapshotBytes = 0;
+	std::uint32_t reserved = 0;
+	std::uint64_t recordFileSize = 0;		// An index made for a different record file is rebuilt
+	std::uint64_t gameCount = 0;
+	std::uint64_t snapshotCount = 0;
+	std::uint64_t entriesOffset = 0;
+	std::uint64_t snapshotsOffset = 0;
+};
+
+struct ReplayIndexEntry
+{
+	std::uint64_t recordOffset = 0;			// Of the game's GameRecordHeader
+	std::uint64_t game = 0;
+	std::uint64_t firstSnapshot = 0;		// Position after the opening spawns; turn k * interval follows k later
+	std::uint32_t turnCount = 0;
+	std::int32_t finalScore = 0;
+};
+
+// Random access to the positions of a mapped record file. Any turn of any game is
+// rebuilt from the nearest earlier snapshot, so a seek replays fewer than
+// snapshotInterval turns however large the archive grows. Opening maps the sidecar
+// index at recordPath.idx, building and writing it first when it is missing or stale,
+// so the record file's directory must be writable the first time.
+class ReplayArchive
+{
+public:
+	static constexpr size_t DEFAULT_SNAPSHOT_INTERVAL = 64;
+
+public:
+	static std::unique_ptr<ReplayArchive> open(const std::string& recordPath, size_t snapshotInterval = DEFAULT_SNAPSHOT_INTERVAL);	// nullptr when invalid
+
+public:
+	std::optional<size_t> findGame(std::uint64_t game) const;		// Entry holding that game index
+	bool loadPosition(size_t entry, size_t turn, Board& board) const;	// Board after that many turns
+	bool readGame(size_t entry, GameRecord& record) const;
+	Board makeEmptyBoard() const;
+
+public:
+	const GameRecordFileHeader& getHeader() const;
+	std::span<const ReplayIndexEntry> getEntries() const;
+	size_t getSnapshotInterval() const;
+
+private:
+	ReplayArchive(MappedFile records, const GameRecordFileHeader& header, size_t snapshotInterval);
+
+	bool loadIndex(const std::string& indexPath);
+	bool buildIndex(const std::string& indexPath);
+	std::span<const std::byte> getGameCodes(const ReplayIndexEntry& entry) const;
+
+private:
+	const MappedFile m_records;
+	const GameRecordFileHeader m_header;
+	const size_t m_cells;
+	const size_t m_snapshotInterval;
+	const size_t m_snapshotBytes;
+
+private:
+	MappedFile m_indexFile;
+	std::span<const ReplayIndexEntry> m_entries;
+	std::span<const std::byte> m_snapshots;
+};
+
+#endif // REPLAY_ARCHIVE_H
@@ -0,0 +1,112 @@
+#include "ReplayVerifier.h"
+#include "WorkStealing.h"
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <thread>
+
+namespace
+{
+	constexpr size_t REPLAY_VERIFIER_CHUNK_GAMES = 64;
+
+	bool isCellEmpty(const Board& board, size_t cell)
+	{
+		return board.getTile(cell / board.getBoardWidth(), cell % board.getBoardWidth()) == 0;
+	}
+
+	void placeSpawn(Board& board, const RecordedSpawn& spawn)
+	{
+		board.setTile(spawn.cell / board.getBoardWidth(), spawn.cell % board.getBoardWidth(), spawn.tile);
+	}
+
+	void verifyWorker(const ReplayArchive& archive, size_t worker, WorkStealingRanges& chunks, ReplayVerification& result)
+	{
+		const std::span<const ReplayIndexEntry> k_entries = archive.getEntries();
+		const Board k_emptyBoard = archive.makeEmptyBoard();
+		Board board = k_emptyBoard;
+		GameRecord record;
+		for (std::optional<size_t> chunk = chunks.next(worker); chunk; chunk = chunks.next(worker))
+		{
+			const size_t k_endEntry = std::min(k_entries.size(), (*chunk + 1) * REPLAY_VERIFIER_CHUNK_GAMES);
+			for (size_t entry = *chunk * REPLAY_VERIFIER_CHUNK_GAMES; entry < k_endEntry; ++entry)
+			{
+				archive.readGame(entry, record);
+				board = k_emptyBoard;
+				if (const std::optional<ReplayDivergence> divergence = verifyReplay(record, board)) { result.divergences.push_back(*divergence); }
+				++result.games;
+				result.moves += record.turns.size();
+			}
+		}
+	}
+}
+
+double ReplayVerification::movesPerSecond() const
+{
+	return seconds > 0.0 ? static_cast<double>(moves) / seconds : 0.0;
+}
+
+double ReplayVerification::gamesPerSecond() const
+{
+	return seconds > 0.0 ? static_cast<double>(games) / seconds : 0.0;
+}
+
+ReplayVerification verifyReplays(const ReplayArchive& archive, size_t threadCount)
+{
+	const size_t k_workers = std::max<size_t>(threadCount, 1);
+	const size_t k_games = archive.getEntries().size();
+	WorkStealingRanges chunks(k_workers, (k_games + REPLAY_VERIFIER_CHUNK_GAMES - 1) / REPLAY_VERIFIER_CHUNK_GAMES);
+	std::vector<ReplayVerification> workerResults(k_workers);
+
+	const auto start = std::chrono::steady_clock::now();
+	{
+		std::vector<std::jthread> threads;
+		threads.reserve(k_workers);
+		for (size_t t = 0; t < k_workers; ++t) { threads.emplace_back(verifyWorker, std::cref(archive), t, std::ref(chunks), std::ref(workerResults[t])); }
+	}
+
+	ReplayVerification result;
+	result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	for (const ReplayVerification& workerResult : workerResults)
+	{
+		result.games += workerResult.games;
+		result.moves += workerResult.moves;
+		result.divergences.insert(result.divergences.end(), workerResult.divergences.begin(), workerResult.divergences.end());
+	}
+	std::sort(result.divergences.begin(), result.divergences.end(),
+		[](const ReplayDivergence& lhs, const ReplayDivergence& rhs) { return lhs.game < rhs.game; });
+	return result;
+}
+
+// Stops at the first broken rule: whatever follows it replays from a board the engine would never have reached
+std::optional<ReplayDivergence> verifyReplay(const GameRecord& record, Board& board)
+{
+	for (const RecordedSpawn& spawn : record.openingSpawns)
+	{
+		if (!isCellEmpty(board, spawn.cell)) { return ReplayDivergence{ record.game, 0, ReplayDivergenceKind::OccupiedSpawn }; }
+		placeSpawn(board, spawn);
+	}
+
+	for (size_t turn = 0; turn < record.turns.size(); ++turn)
+	{
+		if (!board.slide(record.turns[turn].direction)) { return ReplayDivergence{ record.game, turn, ReplayDivergenceKind::IllegalMove }; }
+		if (!isCellEmpty(board, record.turns[turn].spawn.cell)) { return ReplayDivergence{ record.game, turn, ReplayDivergenceKind::OccupiedSpawn }; }
+		placeSpawn(board, record.turns[turn].spawn);
+	}
+
+	if (board.canMove()) { return ReplayDivergence{ record.game, record.turns.size(), ReplayDivergenceKind::UnfinishedGame }; }
+	if (board.getScore() != record.finalScore) { return ReplayDivergence{ record.game, record.turns.size(), ReplayDivergenceKind::WrongScore }; }
+	return std::nullopt;
+}
+
+const char* getDivergenceName(ReplayDivergenceKind kind)
+{
+	switch (kind)
+	{
+	case ReplayDivergenceKind::OccupiedSpawn: return "spawn on an occupied cell";
+	case ReplayDivergenceKind::IllegalMove: return "move that slides nothing";
+	case ReplayDivergenceKind::UnfinishedGame: return "game ended with a legal move left";
+	case ReplayDivergenceKind::WrongScore: return "final score differs";
+	}
+	return "unknown";
+}
@@ -0,0 +1,46 @@
+#ifndef REPLAY_VERIFIER_H
+#define REPLAY_VERIFIER_H
+
+#include "Board.h"
+#include "GameRecord.h"
+#include "ReplayArchive.h"
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+enum class ReplayDivergenceKind
+{
+	OccupiedSpawn,		// A spawn, opening or after a turn, landed on a tile
+	IllegalMove,		// The recorded slide moves nothing
+	UnfinishedGame,		// The game ended with a legal move left
+	WrongScore			// The replayed score differs from the recorded one
+};
+
+struct ReplayDivergence
+{
+	std::uint64_t game = 0;
+	size_t turn = 0;		// Turn index; opening spawns are turn 0, the end of the game is turnCount
+	ReplayDivergenceKind kind = ReplayDivergenceKind::IllegalMove;
+};
+
+struct ReplayVerification
+{
+	std::uint64_t games = 0;
+	std::uint64_t moves = 0;
+	double seconds = 0.0;
+	std::vector<ReplayDivergence> divergences;		// First one of each divergent game, by game index
+
+	double movesPerSecond() const;
+	double gamesPerSecond() const;
+};
+
+// Replays every game of an archive through Board's own slide with the recorded spawns
+// injected, so a change to the move rules shows up as the first turn it breaks. Games
+// are handed to the threads in chunks through work-stealing ranges; each thread counts
+// into its own result, merged once all have finished.
+ReplayVerification verifyReplays(const ReplayArchive& archive, size_t threadCount);
+std::optional<ReplayDivergence> verifyReplay(const GameRecord& record, Board& board);		// board starts empty
+const char* getDivergenceName(ReplayDivergenceKind kind);
+
+#endif // REPLAY_VERIFIER_H
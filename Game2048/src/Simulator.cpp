@@ -0,0 +1,343 @@
+#include "Simulator.h"
+#include "Random.h"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <functional>
+#include <optional>
+#include <thread>
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace
+{
+	constexpr size_t SIMULATOR_INITIAL_TILES = 2;
+	constexpr std::uint64_t SIMULATOR_POLICY_STREAM = ~std::uint64_t{ 0 };		// Never a game index
+	constexpr std::uint64_t SIMULATOR_POLICY_TURN = ~std::uint64_t{ 0 };		// Never a spawn's turn
+
+	// Best effort: a refused request leaves the thread free to migrate
+	void pinCurrentThread(size_t processor)
+	{
+#ifdef _WIN32
+		constexpr size_t k_maskBits = 8 * sizeof(DWORD_PTR);
+		SetThreadAffinityMask(GetCurrentThread(), DWORD_PTR{ 1 } << (processor % k_maskBits));
+#else
+		cpu_set_t processors;
+		CPU_ZERO(&processors);
+		CPU_SET(processor % CPU_SETSIZE, &processors);
+		pthread_setaffinity_np(pthread_self(), sizeof(processors), &processors);
+#endif
+	}
+
+	RecordedSpawn getSpawn(const Board& board, size_t cell)
+	{
+		return RecordedSpawn{ static_cast<std::uint16_t>(cell), board.getTile(cell / board.getBoardWidth(), cell % board.getBoardWidth()) };
+	}
+
+	// Writes a game into its record and dataset, whichever are given
+	class GameLog : public SeededGameObserver
+	{
+	public:
+		GameLog(GameRecord* record, DatasetWriter* dataset) :
+			m_record(record),
+			m_dataset(dataset)
+		{}
+
+		void onSpawn(const Board& board, size_t cell) override
+		{
+			if (m_record) { m_record->openingSpawns.push_back(getSpawn(board, cell)); }
+			if (m_dataset)
+			{
+				m_state = packBoard(board);
+				m_score = board.getScore();
+			}
+		}
+
+		// A move's next state is the following move's state, so each position is packed once
+		void onMove(const Board& board, char direction, size_t cell) override
+		{
+			if (m_record) { m_record->turns.push_back(RecordedTurn{ direction, getSpawn(board, cell) }); }
+			if (m_dataset)
+			{
+				const PackedBoard k_nextState = packBoard(board);
+				m_dataset->addMove(m_state, direction, board.getScore() - m_score, k_nextState);
+				m_state = k_nextState;
+				m_score = board.getScore();
+			}
+		}
+
+	private:
+		GameRecord* const m_record;
+		DatasetWriter* const m_dataset;
+		PackedBoard m_state;
+		int m_score = 0;
+	};
+
+	double perSecond(std::uint64_t count, double seconds)
+	{
+		return (seconds > 0.0) ? static_cast<double>(count) / seconds : 0.0;
+	}
+}
+
+double SimulationResult::meanScore() const
+{
+	return (games > 0) ? static_cast<double>(scoreSum) / static_cast<double>(games) : 0.0;
+}
+
+double SimulationResult::winRate(int winValue) const
+{
+	const std::uint64_t k_wins = maxTiles.countAtLeast(static_cast<std::uint64_t>(winValue));
+	return (games > 0) ? static_cast<double>(k_wins) / static_cast<double>(games) : 0.0;
+}
+
+double SimulationResult::movesPerSecond() const
+{
+	return perSecond(moves, seconds);
+}
+
+double SimulationResult::gamesPerSecond() const
+{
+	return perSecond(games, seconds);
+}
+
+void SimulationResult::merge(const SimulationResult& other)
+{
+	games += other.games;
+	moves += other.moves;
+	scoreSum += other.scoreSum;
+	maxScore = std::max(maxScore, other.maxScore);
+	maxTile = std::max(maxTile, other.maxTile);
+	scores.merge(other.scores);
+	gameLengths.merge(other.gameLengths);
+	maxTiles.merge(other.maxTiles);
+}
+
+void SimulationResult::save(CheckpointWriter& checkpoint) const
+{
+	checkpoint.write(games);
+	checkpoint.write(moves);
+	checkpoint.write(scoreSum);
+	checkpoint.write(maxScore);
+	checkpoint.write(maxTile);
+	checkpoint.write(seconds);
+	scores.save(checkpoint);
+	gameLengths.save(checkpoint);
+	maxTiles.save(checkpoint);
+}
+
+bool SimulationResult::load(CheckpointReader& checkpoint)
+{
+	return checkpoint.read(games) && checkpoint.read(moves) && checkpoint.read(scoreSum) && checkpoint.read(maxScore)
+		&& checkpoint.read(maxTile) && checkpoint.read(seconds)
+		&& scores.load(checkpoint) && gameLengths.load(checkpoint) && maxTiles.load(checkpoint);
+}
+
+Simulator::Simulator(const SimulationSettings& settings, PolicyFactory makePolicy) :
+	m_settings(settings),
+	m_makePolicy(std::move(makePolicy)),
+	m_emptyBoard(Board::makeEmpty(settings.winValue, settings.boardHeight, settings.boardWidth)),
+	m_workerResults(std::max<size_t>(settings.threadCount, 1)),
+	m_workerReports(m_workerResults.size())
+{
+	assert(settings.chunkSize > 0 && "Chunks need at least one game");
+	assert((settings.checkpointPath.empty() || (settings.recordPath.empty() && settings.datasetPath.empty()))
+		&& "Record and dataset shards are rewritten by every period, so they cannot be resumed");
+}
+
+// Without a checkpoint path the run is a single period; with one, every period ends in a
+// checkpoint, so a stopped run loses at most the period it was in
+SimulationResult Simulator::run(std::stop_token stopToken)
+{
+	const size_t k_workers = m_workerResults.size();
+	SimulationResult result = m_resumedResult;
+	std::fill(m_workerReports.begin(), m_workerReports.end(), SimulationWorkerReport{});
+	m_isCheckpointComplete = true;
+
+	const bool k_isCheckpointed = !m_settings.checkpointPath.empty();
+	for (size_t firstGame = m_resumedGames; firstGame < m_settings.games;)
+	{
+		const size_t k_endGame = (k_isCheckpointed && m_settings.checkpointInterval > 0)
+			? std::min(m_settings.games, firstGame + m_settings.checkpointInterval) : m_settings.games;
+		WorkStealingRanges chunks(k_workers, (k_endGame - firstGame + m_settings.chunkSize - 1) / m_settings.chunkSize);
+		const auto start = std::chrono::steady_clock::now();
+		{
+			std::vector<std::jthread> threads;
+			threads.reserve(k_workers);
+			for (size_t t = 0; t < k_workers; ++t) { threads.emplace_back(&Simulator::runWorker, this, t, std::ref(chunks), firstGame, k_endGame); }
+		}
+		const double k_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		for (size_t t = 0; t < k_workers; ++t)
+		{
+			result.merge(m_workerResults[t]);
+			m_workerReports[t].games += m_workerResults[t].games;
+			m_workerReports[t].steals += chunks.getStealCount(t);
+			m_workerReports[t].busySeconds += m_workerResults[t].seconds;
+			m_workerReports[t].idleSeconds += k_seconds - m_workerResults[t].seconds;
+		}
+		result.seconds += k_seconds;
+		firstGame = k_endGame;
+
+		if (k_isCheckpointed)
+		{
+			CheckpointWriter checkpoint(m_settings.checkpointPath, CheckpointKind::Simulation);
+			checkpoint.write(static_cast<std::uint64_t>(m_settings.games));
+			checkpoint.write(m_settings.boardHeight);
+			checkpoint.write(m_settings.boardWidth);
+			checkpoint.write(m_settings.winValue);
+			checkpoint.write(m_settings.seed);
+			checkpoint.writeString(m_settings.policyIdentity);
+			checkpoint.write(static_cast<std::uint64_t>(firstGame));
+			result.save(checkpoint);
+			m_isCheckpointComplete = checkpoint.commit() && m_isCheckpointComplete;
+		}
+		if (stopToken.stop_requested()) { break; }
+	}
+	return result;
+}
+
+// Games finished before the checkpoint are a prefix of the run: periods end only once
+// every game in them is done
+bool Simulator::loadCheckpoint()
+{
+	CheckpointReader checkpoint(m_settings.checkpointPath, CheckpointKind::Simulation);
+	std::uint64_t games = 0;
+	int boardHeight = 0;
+	int boardWidth = 0;
+	int winValue = 0;
+	std::uint64_t seed = 0;
+	std::string policyIdentity;
+	std::uint64_t gamesDone = 0;
+	SimulationResult result;
+	if (!checkpoint.read(games) || !checkpoint.read(boardHeight) || !checkpoint.read(boardWidth) || !checkpoint.read(winValue)
+		|| !checkpoint.read(seed) || !checkpoint.readString(policyIdentity) || !checkpoint.read(gamesDone)
+		|| !result.load(checkpoint) || !checkpoint.isAtEnd()) { return false; }
+	if (games != m_settings.games || boardHeight != m_settings.boardHeight || boardWidth != m_settings.boardWidth
+		|| winValue != m_settings.winValue || seed != m_settings.seed || policyIdentity != m_settings.policyIdentity
+		|| gamesDone > games || result.games != gamesDone) { return false; }
+
+	m_resumedGames = gamesDone;
+	m_resumedResult = result;
+	return true;
+}
+
+const std::vector<SimulationWorkerReport>& Simulator::getWorkerReports() const
+{
+	return m_workerReports;
+}
+
+std::uint64_t Simulator::getResumedGames() const
+{
+	return m_resumedGames;
+}
+
+bool Simulator::isCheckpointComplete() const
+{
+	return m_isCheckpointComplete;
+}
+
+// Board and policy are built on the worker's own thread, so their memory is allocated there
+void Simulator::runWorker(size_t worker, WorkStealingRanges& chunks, size_t firstGame, size_t endGame)
+{
+	const auto start = std::chrono::steady_clock::now();
+	if (m_settings.pinThreads && m_workerResults.size() > 1) { pinCurrentThread(worker); }
+
+	Board board = m_emptyBoard;
+	const std::unique_ptr<Policy> policy = m_makePolicy(randomBitsAt(m_settings.seed, SIMULATOR_POLICY_STREAM, worker));
+	SimulationResult result;
+
+	std::optional<GameRecordWriter> writer;
+	GameRecord record;
+	if (!m_settings.recordPath.empty())
+	{
+		writer.emplace(getRecordShardPath(m_settings.recordPath, worker), makeGameRecordFileHeader(m_settings.boardHeight,
+			m_settings.boardWidth, m_settings.winValue, m_settings.seed, SIMULATOR_INITIAL_TILES));
+	}
+
+	// Boards the dataset format cannot pack leave the writer closed, and the worker reports it
+	std::optional<DatasetWriter> dataset;
+	if (!m_settings.datasetPath.empty())
+	{
+		dataset.emplace(getRecordShardPath(m_settings.datasetPath, worker),
+			makeDatasetFileHeader(m_settings.boardHeight, m_settings.boardWidth, m_settings.seed));
+	}
+	DatasetWriter* const k_dataset = (dataset && dataset->isOpen()) ? &*dataset : nullptr;
+
+	for (std::optional<size_t> chunk = chunks.next(worker); chunk; chunk = chunks.next(worker))
+	{
+		const size_t k_endGame = std::min(endGame, firstGame + (*chunk + 1) * m_settings.chunkSize);
+		for (size_t game = firstGame + *chunk * m_settings.chunkSize; game < k_endGame; ++game)
+		{
+			playGame(*policy, board, game, result, writer ? &record : nullptr, k_dataset);
+			if (writer) { writer->write(record); }
+		}
+	}
+
+	m_workerReports[worker].isRecordComplete = !writer || writer->close();
+	m_workerReports[worker].isDatasetComplete = !dataset || dataset->close();
+	result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	m_workerResults[worker] = result;
+}
+
+// record, when given, keeps its storage from game to game
+void Simulator::playGame(Policy& policy, Board& board, size_t game, SimulationResult& result, GameRecord* record, DatasetWriter* dataset) const
+{
+	if (record)
+	{
+		record->game = game;
+		record->openingSpawns.clear();
+		record->turns.clear();
+	}
+
+	// Without a record or dataset the game runs with no observer to call
+	GameLog log(record, dataset);
+	const std::uint64_t moves = playSeededGame(policy, board, m_settings.seed, game, (record || dataset) ? &log : nullptr);
+	if (record) { record->finalScore = board.getScore(); }
+	if (dataset) { dataset->endGame(); }
+
+	const int k_maxTile = board.getMaxTile();
+	++result.games;
+	result.moves += moves;
+	result.scores.record(static_cast<std::uint64_t>(board.getScore()));
+	result.gameLengths.record(moves);
+	result.maxTiles.record(static_cast<std::uint64_t>(k_maxTile));
+	result.scoreSum += static_cast<std::uint64_t>(board.getScore());
+	result.maxScore = std::max(result.maxScore, board.getScore());
+	result.maxTile = std::max(result.maxTile, k_maxTile);
+}
+
+std::uint64_t playSeededGame(Policy& policy, Board& board, std::uint64_t seed, std::uint64_t game, SeededGameObserver* observer)
+{
+	board.clear();
+	std::uint64_t turn = 0;
+	for (size_t k = 0; k < SIMULATOR_INITIAL_TILES; ++k)
+	{
+		const size_t k_cell = board.spawnTile(randomBitsAt(seed, game, turn++));
+		if (observer) { observer->onSpawn(board, k_cell); }
+	}
+	policy.reseed(randomBitsAt(seed, game, SIMULATOR_POLICY_TURN));
+	policy.newGame();
+
+	std::uint64_t moves = 0;
+	for (char direction = policy.chooseMove(board); direction != 0 && board.slide(direction); direction = policy.chooseMove(board))
+	{
+		const size_t k_cell = board.spawnTile(randomBitsAt(seed, game, turn++));
+		if (observer) { observer->onMove(board, direction, k_cell); }
+		++moves;
+	}
+	return moves;
+}
+
+std::string getRecordShardPath(const std::string& recordPath, size_t worker)
+{
+	return recordPath + "." + std::to_string(worker);
+}
@@ -0,0 +1,129 @@
+#ifndef SIMULATOR_H
+#define SIMULATOR_H
+
+#include "Board.h"
+#include "Checkpoint.h"
+#include "Dataset.h"
+#include "GameRecord.h"
+#include "Histogram.h"
+#include "Policy.h"
+#include "WorkStealing.h"
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <stop_token>
+#include <string>
+#include <vector>
+
+// Builds the policy that plays the games; the seed keeps stochastic policies reproducible.
+// Parallel runs call it once per worker thread, possibly from several threads at once.
+using PolicyFactory = std::function<std::unique_ptr<Policy>(std::uint64_t seed)>;
+
+struct SimulationSettings
+{
+	size_t games = 1000;
+	int boardHeight = 5;
+	int boardWidth = 4;
+	int winValue = 2048;				// Same as Game's; games are played to the end, reaching it only counts as a win
+	std::uint64_t seed = 0;
+	size_t threadCount = 1;
+	bool pinThreads = true;				// Worker t runs on logical processor t only
+	size_t chunkSize = 16;				// Games handed out, or stolen, at a time
+	std::string recordPath;				// When set, worker t writes every game it plays to recordPath.t
+	std::string datasetPath;			// When set, worker t writes every move it plays to datasetPath.t
+	std::string checkpointPath;			// When set, progress is saved here; not combined with records or datasets
+	std::string policyIdentity;			// Names the policy and what shapes its play; a checkpoint resumes only under the same one
+	size_t checkpointInterval = 100000;	// Games between checkpoints, 0 saves only at the end
+};
+
+// Per-game distributions are kept as histograms rather than a list of games, so a
+// result stays the same size however many games it covers
+struct SimulationResult
+{
+	std::uint64_t games = 0;
+	std::uint64_t moves = 0;
+	std::uint64_t scoreSum = 0;
+	int maxScore = 0;
+	int maxTile = 0;
+	double seconds = 0.0;
+	Histogram scores;
+	Histogram gameLengths;				// Moves per game
+	Histogram maxTiles;
+
+	double meanScore() const;
+	double winRate(int winValue) const;		// Share of games whose largest tile reached winValue
+	double movesPerSecond() const;
+	double gamesPerSecond() const;
+	void merge(const SimulationResult& other);		// Adds other's games; seconds are left alone
+	void save(CheckpointWriter& checkpoint) const;
+	bool load(CheckpointReader& checkpoint);
+};
+
+struct SimulationWorkerReport
+{
+	std::uint64_t games = 0;
+	size_t steals = 0;
+	double busySeconds = 0.0;			// From the start of the run until the worker found no work left
+	double idleSeconds = 0.0;			// From then until the last worker finished
+	bool isRecordComplete = true;		// False when the worker's record file could not be written
+	bool isDatasetComplete = true;		// False when the worker's dataset file could not be written
+};
+
+// Plays many headless games with one policy: no rendering and no allocation per move,
+// so runs are bound by the policy and the board alone. Each worker thread builds its own
+// board and policy and counts into its own result, merged once it has finished, so the
+// hot loop writes nothing shared. Games are handed out in chunks through work-stealing
+// ranges, so workers that drew short games take over the tail of those that drew long ones.
+// Spawns come from randomBitsAt(seed, game, turn) and the policy is reseeded from it before
+// every game, so every game is the same whichever worker plays it and whenever it is played.
+// That is what lets a checkpointed run resume: the games it has finished are skipped and
+// their counts restored, and the result matches a run that never stopped. A requested
+// stop ends the run once the current period has been checkpointed.
+class Simulator
+{
+public:
+	Simulator(const SimulationSettings& settings, PolicyFactory makePolicy);
+
+public:
+	SimulationResult run(std::stop_token stopToken = {});		// From the loaded checkpoint, if any
+	bool loadCheckpoint();				// False when it is missing, damaged or from other settings
+
+public:
+	const std::vector<SimulationWorkerReport>& getWorkerReports() const;		// Of the last run
+	std::uint64_t getResumedGames() const;
+	bool isCheckpointComplete() const;	// False when a checkpoint of the last run could not be written
+
+private:
+	void runWorker(size_t worker, WorkStealingRanges& chunks, size_t firstGame, size_t endGame);
+	void playGame(Policy& policy, Board& board, size_t game, SimulationResult& result, GameRecord* record, DatasetWriter* dataset) const;
+
+private:
+	const SimulationSettings m_settings;
+	const PolicyFactory m_makePolicy;
+	const Board m_emptyBoard;
+
+private:
+	std::vector<SimulationResult> m_workerResults;		// Of the current period; seconds hold the worker's busy time
+	std::vector<SimulationWorkerReport> m_workerReports;
+	SimulationResult m_resumedResult;
+	std::uint64_t m_resumedGames = 0;
+	bool m_isCheckpointComplete = true;
+};
+
+// Sees a seeded game as it is played, for callers that keep more than its result
+class SeededGameObserver
+{
+public:
+	virtual ~SeededGameObserver() = default;
+	virtual void onSpawn(const Board& board, size_t cell) = 0;		// An opening tile, before the first move
+	virtual void onMove(const Board& board, char direction, size_t cell) = 0;		// After the slide and the spawn it was followed by
+};
+
+// Plays one game of a seeded run on board, cleared first; Simulator plays every game
+// through it. Returns the number of moves. Two policies given the same game see the
+// same spawn stream.
+std::uint64_t playSeededGame(Policy& policy, Board& board, std::uint64_t seed, std::uint64_t game, SeededGameObserver* observer = nullptr);
+std::string getRecordShardPath(const std::string& recordPath, size_t worker);
+
+#endif // SIMULATOR_H
@@ -0,0 +1,334 @@
+#include "Solver.h"
+#include "PackedBoard.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+namespace
+{
+	constexpr char SEARCH_DIRECTIONS[] = { 'w', 'a', 's', 'd' };
+
+	constexpr int SPAWN_SMALL_TILE_VALUE = 2;
+	constexpr int SPAWN_LARGE_TILE_VALUE = 4;
+	constexpr double SPAWN_SMALL_TILE_PROBABILITY = 0.9;
+	constexpr double SPAWN_LARGE_TILE_PROBABILITY = 0.1;
+
+	// Branches less likely than this are scored by the heuristic instead of searched further
+	constexpr double SEARCH_MIN_PROBABILITY = 0.0001;
+	constexpr size_t SEARCH_NODES_PER_CLOCK_CHECK = 16;
+	constexpr size_t SEARCH_MAX_LINE_LENGTH = 16;
+
+	constexpr size_t CACHE_SIZE_BITS = 18;
+	constexpr std::uint64_t CACHE_INDEX_MASK = (std::uint64_t{ 1 } << CACHE_SIZE_BITS) - 1;
+
+	constexpr double HEURISTIC_BASE_VALUE = 200000.0;
+	constexpr double HEURISTIC_EMPTY_WEIGHT = 270.0;
+	constexpr double HEURISTIC_MERGE_WEIGHT = 700.0;
+	constexpr double HEURISTIC_MONOTONICITY_WEIGHT = 47.0;
+	constexpr double HEURISTIC_MONOTONICITY_POWER = 4.0;
+	constexpr double HEURISTIC_SUM_WEIGHT = 11.0;
+	constexpr double HEURISTIC_SUM_POWER = 3.5;
+
+	constexpr int HEURISTIC_MAX_EXPONENT = 32;
+
+	using PowerTable_t = std::array<double, HEURISTIC_MAX_EXPONENT>;
+
+	// std::pow dominates leaf evaluation otherwise
+	const auto makePowerTable = [](double power) -> PowerTable_t
+	{
+		PowerTable_t table{};
+		for (int exponent = 0; exponent < HEURISTIC_MAX_EXPONENT; ++exponent)
+		{
+			table[exponent] = std::pow(exponent, power);
+		}
+		return table;
+	};
+
+	const PowerTable_t sumPowers = makePowerTable(HEURISTIC_SUM_POWER);
+	const PowerTable_t monotonicityPowers = makePowerTable(HEURISTIC_MONOTONICITY_POWER);
+
+	double evaluateLine(const std::array<int, SEARCH_MAX_LINE_LENGTH>& exponents, size_t length)
+	{
+		double sum = 0.0;
+		int empty = 0;
+		int merges = 0;
+		int previous = 0;
+		int counter = 0;
+		for (size_t k = 0; k < length; ++k)
+		{
+			const int exponent = exponents[k];
+			sum += sumPowers[exponent];
+			if (exponent == 0)
+			{
+				++empty;
+				continue;
+			}
+
+			if (previous == exponent)
+			{
+				++counter;
+			}
+			else if (counter > 0)
+			{
+				merges += 1 + counter;
+				counter = 0;
+			}
+			previous = exponent;
+		}
+		merges += (counter > 0) ? 1 + counter : 0;
+
+		double monotonicityLeft = 0.0;
+		double monotonicityRight = 0.0;
+		for (size_t k = 1; k < length; ++k)
+		{
+			const double before = monotonicityPowers[exponents[k - 1]];
+			const double after = monotonicityPowers[exponents[k]];
+			if (exponents[k - 1] > exponents[k])
+			{
+				monotonicityLeft += before - after;
+			}
+			else
+			{
+				monotonicityRight += after - before;
+			}
+		}
+
+		return HEURISTIC_EMPTY_WEIGHT * empty
+			+ HEURISTIC_MERGE_WEIGHT * merges
+			- HEURISTIC_MONOTONICITY_WEIGHT * std::min(monotonicityLeft, monotonicityRight)
+			- HEURISTIC_SUM_WEIGHT * sum;
+	}
+
+	double evaluatePosition(const Board& board)
+	{
+		const size_t height = board.getBoardHeight();
+		const size_t width = board.getBoardWidth();
+
+		double value = HEURISTIC_BASE_VALUE;
+		std::array<int, SEARCH_MAX_LINE_LENGTH> line{};
+		for (size_t i = 0; i < height; ++i)
+		{
+			for (size_t j = 0; j < width; ++j) { line[j] = getTileExponent(board.getTile(i, j)); }
+			value += evaluateLine(line, width);
+		}
+		for (size_t j = 0; j < width; ++j)
+		{
+			for (size_t i = 0; i < height; ++i) { line[i] = getTileExponent(board.getTile(i, j)); }
+			value += evaluateLine(line, height);
+		}
+		return value;
+	}
+
+	std::uint64_t positionKey(const Board& board)
+	{
+		// FNV-1a over tile exponents followed by a splitmix finaliser to spread the cache index bits
+		std::uint64_t key = 0xcbf29ce484222325;
+		for (size_t i = 0; i < board.getBoardHeight(); ++i)
+		{
+			for (size_t j = 0; j < board.getBoardWidth(); ++j)
+			{
+				key = (key ^ static_cast<std::uint64_t>(getTileExponent(board.getTile(i, j)))) * 0x100000001b3;
+			}
+		}
+		key = (key ^ (key >> 30)) * 0xbf58476d1ce4e5b9;
+		key = (key ^ (key >> 27)) * 0x94d049bb133111eb;
+		return key ^ (key >> 31);
+	}
+}
+
+Solver::Solver(int maxDepth) :
+	m_maxDepth(maxDepth),
+	m_cache(size_t{ 1 } << CACHE_SIZE_BITS)
+{}
+
+SearchResult Solver::findBestMove(const Board& board, std::chrono::microseconds budget, std::stop_token stopToken)
+{
+	beginSearch(board, std::chrono::steady_clock::now() + budget, std::move(stopToken));
+
+	SearchResult best;
+	for (int depth = 1; depth <= m_maxDepth; ++depth)
+	{
+		if (isOutOfTime())
+		{
+			best.isInterrupted = true;
+			break;
+		}
+
+		const SearchResult iteration = searchRoot(board, depth);
+		if (m_isAborted)
+		{
+			best.isInterrupted = true;
+			break;
+		}
+
+		best = iteration;
+		if (best.direction == 0) { break; }
+	}
+
+	// Not even one iteration finished: any legal move beats blocking past the deadline
+	if (best.depth == 0)
+	{
+		for (const char direction : SEARCH_DIRECTIONS)
+		{
+			Board afterstate = board;
+			if (afterstate.slide(direction))
+			{
+				best.direction = direction;
+				break;
+			}
+		}
+	}
+	return best;
+}
+
+void Solver::ponder(const Board& board, std::stop_token stopToken)
+{
+	beginSearch(board, std::chrono::steady_clock::time_point::max(), std::move(stopToken));
+
+	// Deepen every position the opponent can leave us with after our next move,
+	// so the search that follows the user's input starts from cached children
+	Board afterstate = board;
+	Board position = board;
+	for (int depth = 1; depth < m_maxDepth; ++depth)
+	{
+		for (const char direction : SEARCH_DIRECTIONS)
+		{
+			afterstate = board;
+			if (!afterstate.slide(direction)) { continue; }
+
+			const size_t emptyTiles = afterstate.getEmptyTilesCount();
+			for (size_t k = 0; k < emptyTiles; ++k)
+			{
+				for (const int value : { SPAWN_SMALL_TILE_VALUE, SPAWN_LARGE_TILE_VALUE })
+				{
+					position = afterstate;
+					position.placeTile(k, value);
+					searchMove(position, depth, 1.0);
+					if (isOutOfTime()) { return; }
+				}
+			}
+		}
+	}
+}
+
+void Solver::beginSearch(const Board& board, std::chrono::steady_clock::time_point deadline, std::stop_token stopToken)
+{
+	m_deadline = deadline;
+	m_stopToken = std::move(stopToken);
+	m_nodesSinceClockCheck = 0;
+	m_isAborted = false;
+
+	// One scratch board per remaining depth keeps the recursion free of allocations
+	m_afterstates.assign(m_maxDepth + 1, board);
+	m_spawnedBoards.assign(m_maxDepth + 1, board);
+}
+
+SearchResult Solver::searchRoot(const Board& board, int depth)
+{
+	SearchResult result;
+	result.depth = depth;
+
+	Board& afterstate = m_afterstates[depth];
+	for (const char direction : SEARCH_DIRECTIONS)
+	{
+		afterstate = board;
+		if (!afterstate.slide(direction)) { continue; }
+
+		const double value = searchSpawn(afterstate, depth, 1.0);
+		if (m_isAborted) { return result; }
+
+		if (result.direction == 0 || value > result.expectedValue)
+		{
+			result.direction = direction;
+			result.expectedValue = value;
+		}
+	}
+	return result;
+}
+
+double Solver::searchMove(const Board& board, int depth, double probability)
+{
+	if (depth == 0 || probability < SEARCH_MIN_PROBABILITY)
+	{
+		return evaluatePosition(board);
+	}
+
+	const std::uint64_t key = positionKey(board);
+	CacheEntry& entry = m_cache[key & CACHE_INDEX_MASK];
+	if (entry.key == key && entry.depth >= depth) { return entry.value; }
+
+	// A board without legal moves is lost and scores zero
+	double best = 0.0;
+	Board& afterstate = m_afterstates[depth];
+	for (const char direction : SEARCH_DIRECTIONS)
+	{
+		afterstate = board;
+		if (!afterstate.slide(direction)) { continue; }
+
+		best = std::max(best, searchSpawn(afterstate, depth, probability));
+		if (isAborted()) { return 0.0; }
+	}
+
+	entry = CacheEntry{ key, static_cast<float>(best), static_cast<std::int8_t>(depth) };
+	return best;
+}
+
+double Solver::searchSpawn(const Board& afterstate, int depth, double probability)
+{
+	const size_t emptyTiles = afterstate.getEmptyTilesCount();
+	if (emptyTiles == 0) { return searchMove(afterstate, depth - 1, probability); }
+
+	const double cellProbability = probability / static_cast<double>(emptyTiles);
+	double expected = 0.0;
+
+	Board& spawned = m_spawnedBoards[depth];
+	for (size_t k = 0; k < emptyTiles; ++k)
+	{
+		spawned = afterstate;
+		spawned.placeTile(k, SPAWN_SMALL_TILE_VALUE);
+		expected += SPAWN_SMALL_TILE_PROBABILITY * searchMove(spawned, depth - 1, cellProbability * SPAWN_SMALL_TILE_PROBABILITY);
+
+		spawned = afterstate;
+		spawned.placeTile(k, SPAWN_LARGE_TILE_VALUE);
+		expected += SPAWN_LARGE_TILE_PROBABILITY * searchMove(spawned, depth - 1, cellProbability * SPAWN_LARGE_TILE_PROBABILITY);
+
+		if (isAborted()) { return 0.0; }
+	}
+	return expected / static_cast<double>(emptyTiles);
+}
+
+bool Solver::isAborted()
+{
+	if (m_isAborted) { return true; }
+	if (++m_nodesSinceClockCheck < SEARCH_NODES_PER_CLOCK_CHECK) { return false; }
+
+	m_nodesSinceClockCheck = 0;
+	m_isAborted = isOutOfTime();
+	return m_isAborted;
+}
+
+bool Solver::isOutOfTime() const
+{
+	return m_stopToken.stop_requested() || std::chrono::steady_clock::now() >= m_deadline;
+}
+
+#ifdef _DEBUG
+std::optional<Solver::CachedValue> Solver::findCachedValue(const Board& board) const
+{
+	const std::uint64_t key = positionKey(board);
+	const CacheEntry& entry = m_cache[key & CACHE_INDEX_MASK];
+	if (entry.key != key) { return std::nullopt; }
+	return CachedValue{ entry.value, entry.depth };
+}
+#endif
+
+ExpectimaxPolicy::ExpectimaxPolicy(std::chrono::microseconds budget, int maxDepth) :
+	m_solver(maxDepth),
+	m_budget(budget)
+{}
+
+char ExpectimaxPolicy::chooseMove(const Board& board)
+{
+	return m_solver.findBestMove(board, m_budget).direction;
+}
@@ -0,0 +1,87 @@
+#ifndef SOLVER_H
+#define SOLVER_H
+
+#include "Board.h"
+#include "Policy.h"
+
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <stop_token>
+#include <vector>
+
+struct SearchResult
+{
+	char direction = 0;				// 0 when the board has no legal move
+	double expectedValue = 0.0;
+	int depth = 0;					// Deepest iteration that completed before the deadline
+	bool isInterrupted = false;		// Deadline or cancellation cut the deepening short
+};
+
+// Expectimax search deepened one move at a time; the answer always comes from
+// the deepest iteration that finished, so the caller gets a move within the budget.
+// Searched positions are kept in a transposition cache shared by later searches.
+// Not thread-safe: one search or ponder at a time per instance.
+class Solver
+{
+public:
+	explicit Solver(int maxDepth = DEFAULT_MAX_DEPTH);
+
+public:
+	SearchResult findBestMove(const Board& board, std::chrono::microseconds budget, std::stop_token stopToken = {});
+	void ponder(const Board& board, std::stop_token stopToken);
+
+public:
+	static constexpr int DEFAULT_MAX_DEPTH = 6;
+
+#ifdef _DEBUG
+public: // For Google Tests
+	struct CachedValue
+	{
+		float value = 0.0f;
+		int depth = 0;
+	};
+	std::optional<CachedValue> findCachedValue(const Board& board) const;
+#endif
+
+private:
+	struct CacheEntry
+	{
+		std::uint64_t key = 0;
+		float value = 0.0f;
+		std::int8_t depth = 0;
+	};
+
+private:
+	void beginSearch(const Board& board, std::chrono::steady_clock::time_point deadline, std::stop_token stopToken);
+	SearchResult searchRoot(const Board& board, int depth);
+	double searchMove(const Board& board, int depth, double probability);
+	double searchSpawn(const Board& afterstate, int depth, double probability);
+	bool isAborted();
+	bool isOutOfTime() const;
+
+private:
+	const int m_maxDepth;
+
+private:
+	std::vector<CacheEntry> m_cache;
+	std::vector<Board> m_afterstates;
+	std::vector<Board> m_spawnedBoards;
+	std::chrono::steady_clock::time_point m_deadline;
+	std::stop_token m_stopToken;
+	size_t m_nodesSinceClockCheck = 0;
+	bool m_isAborted = false;
+};
+
+class ExpectimaxPolicy : public Policy
+{
+public:
+	explicit ExpectimaxPolicy(std::chrono::microseconds budget, int maxDepth = Solver::DEFAULT_MAX_DEPTH);
+	char chooseMove(const Board& board) override;
+
+private:
+	Solver m_solver;
+	const std::chrono::microseconds m_budget;
+};
+
+#endif // SOLVER_H
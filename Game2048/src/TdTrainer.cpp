@@ -0,0 +1,407 @@
+#include "TdTrainer.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+namespace
+{
+	constexpr size_t TRAINER_INITIAL_TILES = 2;
+	constexpr size_t TRAINER_EPISODE_RESERVE = 4096;
+	constexpr std::uint64_t TRAINER_EVALUATION_STREAM = 0;
+	constexpr std::uint64_t TRAINER_FIRST_WORKER_STREAM = 1;
+
+	// Everything that shapes the weights a run trains; a checkpoint only resumes the same run
+	struct TrainingFingerprint
+	{
+		std::uint64_t games = 0;
+		std::uint64_t seed = 0;
+		std::uint64_t threadCount = 0;
+		std::uint64_t weightCount = 0;
+		std::uint64_t layoutHash = 0;
+		std::uint64_t stagePoolSize = 0;
+		float learningRate = 0.0f;
+		float finalLearningRate = 0.0f;
+		float lambda = 0.0f;
+		float stageStartShare = 0.0f;
+		std::uint32_t schedule = 0;
+		std::uint32_t cells = 0;
+
+		friend bool operator==(const TrainingFingerprint& lhs, const TrainingFingerprint& rhs) = default;
+	};
+
+	// FNV-1a over the tuple cells and stage starts, each list led by its length: layouts with
+	// the same weight count but other tuples or stages must not resume each other's weights
+	std::uint64_t hashLayout(const NTupleLayout& layout)
+	{
+		std::uint64_t hash = 0xcbf29ce484222325;
+		const auto mix = [&hash](std::uint64_t value) { hash = (hash ^ value) * 0x100000001b3; };
+
+		mix(layout.getTuples().size());
+		for (const NTuple_t& tuple : layout.getTuples())
+		{
+			mix(tuple.size());
+			for (const size_t cell : tuple) { mix(cell); }
+		}
+		mix(layout.getStageStarts().size());
+		for (const int stageStart : layout.getStageStarts()) { mix(static_cast<std::uint64_t>(stageStart)); }
+		return hash;
+	}
+
+	TrainingFingerprint makeFingerprint(const TdTrainingSettings& settings, const NTupleNetwork& network, size_t threadCount, size_t games)
+	{
+		TrainingFingerprint fingerprint;
+		fingerprint.games = games;
+		fingerprint.seed = settings.seed;
+		fingerprint.threadCount = threadCount;
+		fingerprint.weightCount = network.getWeightCount();
+		fingerprint.layoutHash = hashLayout(network.getLayout());
+		fingerprint.stagePoolSize = settings.stagePoolSize;
+		fingerprint.learningRate = settings.learningRate;
+		fingerprint.finalLearningRate = settings.finalLearningRate;
+		fingerprint.lambda = settings.lambda;
+		fingerprint.stageStartShare = settings.stageStartShare;
+		fingerprint.schedule = static_cast<std::uint32_t>(settings.schedule);
+		fingerprint.cells = static_cast<std::uint32_t>(network.getBoardHeight() * network.getBoardWidth());
+		return fingerprint;
+	}
+
+	// Score, then one tile exponent byte per cell
+	void saveBoard(CheckpointWriter& checkpoint, const Board& board)
+	{
+		checkpoint.write(static_cast<std::int32_t>(board.getScore()));
+		for (size_t i = 0; i < board.getBoardHeight(); ++i)
+		{
+			for (size_t j = 0; j < board.getBoardWidth(); ++j)
+			{
+				checkpoint.write(static_cast<std::uint8_t>(getTileExponent(board.getTile(i, j))));
+			}
+		}
+	}
+
+	bool loadBoard(CheckpointReader& checkpoint, Board& board)
+	{
+		std::int32_t score = 0;
+		if (!checkpoint.read(score)) { return false; }
+		board.setScore(score);
+		for (size_t i = 0; i < board.getBoardHeight(); ++i)
+		{
+			for (size_t j = 0; j < board.getBoardWidth(); ++j)
+			{
+				std::uint8_t exponent = 0;
+				if (!checkpoint.read(exponent) || exponent >= 31) { return false; }
+				board.setTile(i, j, getExponentTile(exponent));
+			}
+		}
+		return true;
+	}
+}
+
+TdTrainer::TdTrainer(NTupleNetwork& network, const TdTrainingSettings& settings) :
+	m_network(network),
+	m_settings(settings),
+	m_emptyBoard(Board::makeEmpty(settings.winValue, static_cast<int>(network.getBoardHeight()), static_cast<int>(network.getBoardWidth())))
+{
+	const size_t k_threadCount = std::max<size_t>(settings.threadCount, 1);
+	m_workers.reserve(k_threadCount);
+	for (size_t t = 0; t < k_threadCount; ++t)
+	{
+		// Independent stream per thread, reproducible from the trainer seed
+		std::seed_seq streamSeed { settings.seed, TRAINER_FIRST_WORKER_STREAM + static_cast<std::uint64_t>(t) };
+		Worker& worker = m_workers.emplace_back(Worker{ m_emptyBoard, m_emptyBoard, std::mt19937_64(streamSeed), {}, {}, {} });
+		worker.afterstates.reserve(TRAINER_EPISODE_RESERVE);
+		worker.rewards.reserve(TRAINER_EPISODE_RESERVE);
+		worker.stagePositions.resize(network.getLayout().getStageCount());
+	}
+}
+
+// Periods end at every evaluation and every checkpoint; the threads are joined at each,
+// so the weights they leave are complete
+TrainingEvaluation TdTrainer::train(size_t games, std::ostream& log, std::stop_token stopToken)
+{
+	const auto nextMultiple = [](size_t value, size_t interval) { return (value / interval + 1) * interval; };
+	const bool k_isCheckpointed = !m_settings.checkpointPath.empty();
+	TrainingEvaluation last;
+	m_isCheckpointComplete = true;
+	auto evaluationPeriodStart = std::chrono::steady_clock::now();
+	size_t evaluationPeriodFirstGame = m_resumedGames;
+	for (size_t trained = m_resumedGames; trained < games;)
+	{
+		size_t periodEnd = games;
+		if (m_settings.evaluationInterval) { periodEnd = std::min(periodEnd, nextMultiple(trained, m_settings.evaluationInterval)); }
+		if (k_isCheckpointed && m_settings.checkpointInterval) { periodEnd = std::min(periodEnd, nextMultiple(trained, m_settings.checkpointInterval)); }
+
+		// Reset every period: threads overshoot the ticket counter by one claim each on their way out
+		m_nextGame.store(trained, std::memory_order_relaxed);
+		{
+			std::vector<std::jthread> threads;
+			threads.reserve(m_workers.size() - 1);
+			for (size_t t = 1; t < m_workers.size(); ++t)
+			{
+				threads.emplace_back([this, t, periodEnd, games] { trainGames(m_workers[t], periodEnd, games); });
+			}
+			trainGames(m_workers.front(), periodEnd, games);
+		}
+		trained = periodEnd;
+
+		if (m_settings.evaluationInterval != 0 && trained % m_settings.evaluationInterval == 0)
+		{
+			const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - evaluationPeriodStart;
+			last = evaluate(m_settings.evaluationGames);
+			last.gamesPerSecond = static_cast<double>(trained - evaluationPeriodFirstGame) / elapsed.count();
+
+			log << "games " << std::setw(10) << last.gamesTrained
+				<< "  mean " << std::setw(8) << static_cast<long long>(last.meanScore)
+				<< "  max " << std::setw(8) << last.maxScore
+				<< "  win " << std::fixed << std::setprecision(2) << std::setw(6) << 100.0 * last.winRate << '%'
+				<< "  games/s " << std::setprecision(0) << last.gamesPerSecond << '\n';
+			log.unsetf(std::ios::fixed);
+			evaluationPeriodStart = std::chrono::steady_clock::now();
+			evaluationPeriodFirstGame = trained;
+		}
+
+		// Saved after the evaluation, so a resumed run never skips one
+		const bool k_isCheckpointDue = trained == games || (m_settings.checkpointInterval && trained % m_settings.checkpointInterval == 0);
+		if (k_isCheckpointed && k_isCheckpointDue)
+		{
+			m_isCheckpointComplete = saveCheckpoint(trained, games) && m_isCheckpointComplete;
+			if (stopToken.stop_requested()) { break; }
+		}
+	}
+	return last;
+}
+
+// Greedy play without learning; every evaluation replays the same spawn sequence
+TrainingEvaluation TdTrainer::evaluate(size_t games)
+{
+	TrainingEvaluation evaluation;
+	evaluation.gamesTrained = getGamesPlayed();
+	Board& board = m_workers.front().board;
+	Board& scratch = m_workers.front().scratch;
+
+	std::seed_seq streamSeed { m_settings.seed, TRAINER_EVALUATION_STREAM };
+	std::mt19937_64 generator(streamSeed);
+	size_t wins = 0;
+	double scoreSum = 0.0;
+	for (size_t game = 0; game < games; ++game)
+	{
+		startGame(board, generator);
+		for (NTupleMove move = findGreedyMove(m_network, board, scratch); move.direction != 0;
+			move = findGreedyMove(m_network, board, scratch))
+		{
+			board.slide(move.direction);
+			board.spawnTile(generator());
+		}
+
+		scoreSum += board.getScore();
+		evaluation.maxScore = std::max(evaluation.maxScore, board.getScore());
+		wins += board.getMaxTile() >= m_settings.winValue;
+	}
+
+	if (games > 0)
+	{
+		evaluation.meanScore = scoreSum / static_cast<double>(games);
+		evaluation.winRate = static_cast<double>(wins) / static_cast<double>(games);
+	}
+	return evaluation;
+}
+
+std::uint64_t TdTrainer::getGamesPlayed() const
+{
+	std::uint64_t games = 0;
+	for (const Worker& worker : m_workers) { games += worker.gamesPlayed; }
+	return games;
+}
+
+std::uint64_t TdTrainer::getMovesPlayed() const
+{
+	std::uint64_t moves = 0;
+	for (const Worker& worker : m_workers) { moves += worker.movesPlayed; }
+	return moves;
+}
+
+std::uint64_t TdTrainer::getResumedGames() const
+{
+	return m_resumedGames;
+}
+
+bool TdTrainer::isCheckpointComplete() const
+{
+	return m_isCheckpointComplete;
+}
+
+// Nothing is changed until the whole checkpoint has been read and checked
+bool TdTrainer::loadCheckpoint(size_t games)
+{
+	CheckpointReader checkpoint(m_settings.checkpointPath, CheckpointKind::Training);
+	TrainingFingerprint fingerprint;
+	std::uint64_t trained = 0;
+	if (!checkpoint.read(fingerprint) || !(fingerprint == makeFingerprint(m_settings, m_network, m_workers.size(), games))) { return false; }
+	if (!checkpoint.read(trained) || trained > games) { return false; }
+
+	std::vector<float> weights(m_network.getWeightCount());
+	if (!checkpoint.readBytes(weights.data(), weights.size() * sizeof(float))) { return false; }
+
+	std::vector<Worker> workers = m_workers;
+	for (Worker& worker : workers)
+	{
+		std::string generator;
+		if (!checkpoint.readString(generator) || !checkpoint.read(worker.gamesPlayed) || !checkpoint.read(worker.movesPlayed)) { return false; }
+		std::istringstream generatorStream(generator);
+		if (!(generatorStream >> worker.generator)) { return false; }
+
+		for (std::vector<Board>& positions : worker.stagePositions)
+		{
+			std::uint64_t count = 0;
+			if (!checkpoint.read(count) || count > m_settings.stagePoolSize) { return false; }
+			positions.assign(static_cast<size_t>(count), m_emptyBoard);
+			for (Board& position : positions)
+			{
+				if (!loadBoard(checkpoint, position)) { return false; }
+			}
+		}
+	}
+	if (!checkpoint.isAtEnd()) { return false; }
+
+	m_network.setWeights(weights);
+	for (size_t t = 0; t < m_workers.size(); ++t)
+	{
+		m_workers[t].generator = workers[t].generator;
+		m_workers[t].gamesPlayed = workers[t].gamesPlayed;
+		m_workers[t].movesPlayed = workers[t].movesPlayed;
+		m_workers[t].stagePositions = std::move(workers[t].stagePositions);
+	}
+	m_resumedGames = static_cast<size_t>(trained);
+	return true;
+}
+
+bool TdTrainer::saveCheckpoint(size_t trained, size_t games) const
+{
+	CheckpointWriter checkpoint(m_settings.checkpointPath, CheckpointKind::Training);
+	checkpoint.write(makeFingerprint(m_settings, m_network, m_workers.size(), games));
+	checkpoint.write(static_cast<std::uint64_t>(trained));
+	checkpoint.writeBytes(m_network.getWeights().data(), m_network.getWeights().size_bytes());
+	for (const Worker& worker : m_workers)
+	{
+		std::ostringstream generator;
+		generator << worker.generator;
+		checkpoint.writeString(generator.str());
+		checkpoint.write(worker.gamesPlayed);
+		checkpoint.write(worker.movesPlayed);
+		for (const std::vector<Board>& positions : worker.stagePositions)
+		{
+			checkpoint.write(static_cast<std::uint64_t>(positions.size()));
+			for (const Board& position : positions) { saveBoard(checkpoint, position); }
+		}
+	}
+	return checkpoint.commit();
+}
+
+void TdTrainer::trainGames(Worker& worker, size_t endGame, size_t games)
+{
+	for (size_t game = m_nextGame.fetch_add(1, std::memory_order_relaxed); game < endGame;
+		game = m_nextGame.fetch_add(1, std::memory_order_relaxed))
+	{
+		playTrainingGame(worker, learningRateAt(game, games));
+	}
+}
+
+void TdTrainer::playTrainingGame(Worker& worker, float learningRate)
+{
+	worker.afterstates.clear();
+	worker.rewards.clear();
+
+	const NTupleLayout& layout = m_network.getLayout();
+	startTrainingGame(worker);
+	size_t stage = layout.getStage(packBoard(worker.board));
+	for (NTupleMove move = findGreedyMove(m_network, worker.board, worker.scratch); move.direction != 0;
+		move = findGreedyMove(m_network, worker.board, worker.scratch))
+	{
+		worker.board.slide(move.direction);
+		worker.afterstates.push_back(move.afterstate);
+		worker.rewards.push_back(move.reward);
+		worker.board.spawnTile(worker.generator());
+
+		if (layout.getStage(move.afterstate) > stage)
+		{
+			stage = layout.getStage(move.afterstate);
+			keepStagePosition(worker, stage);
+		}
+	}
+
+	// The target of each afterstate is the next reward plus the lambda-return of the
+	// next afterstate; the last afterstate leads to a lost board worth nothing
+	const float k_step = learningRate / static_cast<float>(m_network.getFeatureCount());
+	const float k_lambda = m_settings.lambda;
+	float target = 0.0f;
+	for (size_t t = worker.afterstates.size(); t-- > 0;)
+	{
+		const float value = m_network.evaluate(worker.afterstates[t]);
+		m_network.update(worker.afterstates[t], k_step * (target - value));
+		target = static_cast<float>(worker.rewards[t]) + k_lambda * target + (1.0f - k_lambda) * value;
+	}
+
+	++worker.gamesPlayed;
+	worker.movesPlayed += worker.afterstates.size();
+}
+
+void TdTrainer::startTrainingGame(Worker& worker) const
+{
+	std::uniform_real_distribution<float> share;
+	if (worker.stagePositions.size() > 1 && share(worker.generator) < m_settings.stageStartShare)
+	{
+		// Later stages are picked uniformly, so the rarest one gets as many games as the others
+		std::array<size_t, PackedBoard::MAX_EXPONENT + 1> filledStages {};
+		size_t filledStageCount = 0;
+		for (size_t s = 1; s < worker.stagePositions.size(); ++s)
+		{
+			if (!worker.stagePositions[s].empty()) { filledStages[filledStageCount++] = s; }
+		}
+		if (filledStageCount > 0)
+		{
+			const std::vector<Board>& positions = worker.stagePositions[filledStages[worker.generator() % filledStageCount]];
+			worker.board = positions[worker.generator() % positions.size()];
+			return;
+		}
+	}
+	startGame(worker.board, worker.generator);
+}
+
+// Fills the pool, then replaces a random kept position
+void TdTrainer::keepStagePosition(Worker& worker, size_t stage) const
+{
+	std::vector<Board>& positions = worker.stagePositions[stage];
+	if (m_settings.stagePoolSize == 0) { return; }
+
+	if (positions.size() < m_settings.stagePoolSize)
+	{
+		positions.push_back(worker.board);
+		return;
+	}
+	positions[worker.generator() % positions.size()] = worker.board;
+}
+
+void TdTrainer::startGame(Board& board, std::mt19937_64& generator) const
+{
+	board = m_emptyBoard;
+	for (size_t k = 0; k < TRAINER_INITIAL_TILES; ++k) { board.spawnTile(generator()); }
+}
+
+float TdTrainer::learningRateAt(size_t game, size_t games) const
+{
+	const float progress = (games > 1) ? static_cast<float>(game) / static_cast<float>(games - 1) : 0.0f;
+	switch (m_settings.schedule)
+	{
+	case LearningRateSchedule::Linear:
+		return m_settings.learningRate + (m_settings.finalLearningRate - m_settings.learningRate) * progress;
+	case LearningRateSchedule::Exponential:
+		return m_settings.learningRate * std::pow(m_settings.finalLearningRate / m_settings.learningRate, progress);
+	default:
+		return m_settings.learningRate;
+	}
+}
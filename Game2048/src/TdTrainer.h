@@ -0,0 +1,109 @@
+#ifndef TD_TRAINER_H
+#define TD_TRAINER_H
+
+#include "Board.h"
+#include "Checkpoint.h"
+#include "NTupleNetwork.h"
+#include "PackedBoard.h"
+
+#include <atomic>
+#include <cstdint>
+#include <iosfwd>
+#include <random>
+#include <stop_token>
+#include <string>
+#include <vector>
+
+enum class LearningRateSchedule
+{
+	Constant,
+	Linear,			// Straight line from the initial to the final rate over the run
+	Exponential		// Geometric decay from the initial to the final rate over the run
+};
+
+struct TdTrainingSettings
+{
+	float learningRate = 0.1f;			// Per position; spread evenly over the network's features
+	float finalLearningRate = 0.01f;
+	LearningRateSchedule schedule = LearningRateSchedule::Constant;
+	float lambda = 0.0f;				// 0 gives TD(0); larger values blend in longer returns
+	size_t evaluationInterval = 1000;	// Training games between evaluations, 0 disables them
+	size_t evaluationGames = 100;
+	int winValue = 2048;
+	size_t threadCount = 1;				// Self-play threads sharing the network's weights without locks
+	size_t stagePoolSize = 1000;		// Positions kept per game stage, from games that just entered it
+	float stageStartShare = 0.5f;		// Share of games started from a kept position of a later stage
+	std::uint64_t seed = 0;
+	std::string checkpointPath;			// When set, weights and generator positions are saved here
+	size_t checkpointInterval = 10000;	// Training games between checkpoints, 0 saves only at the end
+};
+
+struct TrainingEvaluation
+{
+	size_t gamesTrained = 0;
+	double meanScore = 0.0;
+	int maxScore = 0;
+	double winRate = 0.0;				// Share of games that reached winValue
+	double gamesPerSecond = 0.0;		// Training throughput since the previous evaluation
+};
+
+// Self-play TD learning of afterstate values. Each game is played greedily by the
+// network and then learned backwards from its last afterstate, so TD(lambda)
+// needs no eligibility traces. Episode buffers are reused: no allocation per move.
+// With several threads, each plays its own games and writes the shared weights
+// Hogwild-style: relaxed, unsynchronised updates that may occasionally overwrite each other.
+// For staged networks, the position where a game first enters a later stage is kept, and
+// some games restart from those so that late stages train without replaying the opening.
+// A checkpoint holds the weights and every thread's generator and kept positions, so a
+// single-threaded run resumed from one trains exactly the weights of a run that never stopped.
+class TdTrainer
+{
+public:
+	TdTrainer(NTupleNetwork& network, const TdTrainingSettings& settings);
+
+public:
+	TrainingEvaluation train(size_t games, std::ostream& log, std::stop_token stopToken = {});	// A stop ends it at the next checkpoint
+	TrainingEvaluation evaluate(size_t games);
+	bool loadCheckpoint(size_t games);		// False when it is missing, damaged or from another run of that many games
+
+public:
+	std::uint64_t getGamesPlayed() const;
+	std::uint64_t getMovesPlayed() const;
+	std::uint64_t getResumedGames() const;
+	bool isCheckpointComplete() const;		// False when a checkpoint of the last run could not be written
+
+private:
+	struct alignas(64) Worker
+	{
+		Board board;
+		Board scratch;
+		std::mt19937_64 generator;
+		std::vector<PackedBoard> afterstates;
+		std::vector<int> rewards;
+		std::vector<std::vector<Board>> stagePositions;		// Per stage; stage 0 always starts fresh
+		std::uint64_t gamesPlayed = 0;
+		std::uint64_t movesPlayed = 0;
+	};
+
+private:
+	void trainGames(Worker& worker, size_t endGame, size_t games);
+	void playTrainingGame(Worker& worker, float learningRate);
+	void startTrainingGame(Worker& worker) const;
+	void keepStagePosition(Worker& worker, size_t stage) const;
+	void startGame(Board& board, std::mt19937_64& generator) const;
+	float learningRateAt(size_t game, size_t games) const;
+	bool saveCheckpoint(size_t trained, size_t games) const;
+
+private:
+	NTupleNetwork& m_network;
+	const TdTrainingSettings m_settings;
+	const Board m_emptyBoard;
+
+private:
+	std::vector<Worker> m_workers;
+	std::atomic<size_t> m_nextGame = 0;
+	size_t m_resumedGames = 0;
+	bool m_isCheckpointComplete = true;
+};
+
+#endif // TD_TRAINER_H
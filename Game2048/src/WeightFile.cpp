@@ -0,0 +1,224 @@
+#include "WeightFile.h"
+
+#include <cstddef>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+namespace
+{
+	constexpr std::array<char, 8> WEIGHT_FILE_MAGIC = { '2', '0', '4', '8', 'N', 'T', 'W', '\0' };
+	constexpr std::uint32_t WEIGHT_FILE_VERSION = 2;
+	constexpr std::uint32_t WEIGHT_FILE_TUPLE_RECORD_SIZE = 1 + NTupleLayout::MAX_TUPLE_SIZE;
+	constexpr std::uint64_t WEIGHT_FILE_SECTION_ALIGNMENT = 64;
+
+	static_assert(sizeof(WeightFileHeader) == 104, "Weight file header must have no padding");
+
+	std::uint64_t alignSection(std::uint64_t offset)
+	{
+		return (offset + WEIGHT_FILE_SECTION_ALIGNMENT - 1) / WEIGHT_FILE_SECTION_ALIGNMENT * WEIGHT_FILE_SECTION_ALIGNMENT;
+	}
+
+	std::uint64_t headerChecksum(const WeightFileHeader& header)
+	{
+		const auto* bytes = reinterpret_cast<const unsigned char*>(&header);
+		std::uint64_t hash = 0xcbf29ce484222325;
+		for (size_t k = 0; k < offsetof(WeightFileHeader, checksum); ++k)
+		{
+			hash = (hash ^ bytes[k]) * 0x100000001b3;
+		}
+		return hash;
+	}
+
+	void writeAt(std::ofstream& file, std::uint64_t offset, const void* data, size_t size)
+	{
+		file.seekp(static_cast<std::streamoff>(offset));
+		file.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+	}
+
+	template <typename Weight_t>
+	bool writeSections(const std::string& path, WeightType weightType, const NTupleLayout& layout,
+		std::span<const float> tableScales, std::span<const Weight_t> weights)
+	{
+		const std::vector<NTuple_t>& tuples = layout.getTuples();
+
+		WeightFileHeader header;
+		header.magic = WEIGHT_FILE_MAGIC;
+		header.version = WEIGHT_FILE_VERSION;
+		header.weightType = weightType;
+		header.boardHeight = static_cast<std::uint32_t>(layout.getBoardHeight());
+		header.boardWidth = static_cast<std::uint32_t>(layout.getBoardWidth());
+		header.tupleCount = static_cast<std::uint32_t>(tuples.size());
+		header.tupleRecordSize = WEIGHT_FILE_TUPLE_RECORD_SIZE;
+		header.stageCount = static_cast<std::uint32_t>(layout.getStageCount());
+		for (size_t s = 0; s < layout.getStageStarts().size(); ++s) { header.stageStarts[s] = static_cast<std::uint8_t>(layout.getStageStarts()[s]); }
+		header.tuplesOffset = alignSection(sizeof(WeightFileHeader));
+		header.scalesOffset = alignSection(header.tuplesOffset + tuples.size() * WEIGHT_FILE_TUPLE_RECORD_SIZE);
+		header.weightsOffset = alignSection(header.scalesOffset + tableScales.size_bytes());
+		header.weightCount = weights.size();
+		header.fileSize = header.weightsOffset + weights.size_bytes();
+		header.checksum = headerChecksum(header);
+
+		const std::string temporaryPath = path + ".tmp";
+		{
+			std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+			writeAt(file, 0, &header, sizeof(header));
+			for (size_t t = 0; t < tuples.size(); ++t)
+			{
+				std::array<std::uint8_t, WEIGHT_FILE_TUPLE_RECORD_SIZE> record {};
+				record[0] = static_cast<std::uint8_t>(tuples[t].size());
+				for (size_t k = 0; k < tuples[t].size(); ++k) { record[1 + k] = static_cast<std::uint8_t>(tuples[t][k]); }
+				writeAt(file, header.tuplesOffset + t * record.size(), record.data(), record.size());
+			}
+			writeAt(file, header.scalesOffset, tableScales.data(), tableScales.size_bytes());
+			writeAt(file, header.weightsOffset, weights.data(), weights.size_bytes());
+			if (!file.flush()) { return false; }
+		}
+
+		std::error_code error;
+		std::filesystem::rename(temporaryPath, path, error);
+		return !error;
+	}
+
+	// Everything the layout and the evaluator index with is checked here, so a damaged
+	// or foreign file is rejected instead of read out of bounds
+	bool readStages(const WeightFileHeader& header, std::vector<int>& stageStarts)
+	{
+		if (header.stageCount == 0 || header.stageCount > header.stageStarts.size()) { return false; }
+		for (size_t s = 0; s + 1 < header.stageCount; ++s)
+		{
+			const int start = header.stageStarts[s];
+			if (start < 1 || start > PackedBoard::MAX_EXPONENT || (s > 0 && start <= stageStarts.back())) { return false; }
+			stageStarts.push_back(start);
+		}
+		return true;
+	}
+
+	bool readTuples(std::span<const std::byte> bytes, const WeightFileHeader& header, std::vector<NTuple_t>& tuples)
+	{
+		const std::uint64_t k_cells = std::uint64_t{ header.boardHeight } * header.boardWidth;
+		if (header.boardHeight == 0 || header.boardWidth == 0 || k_cells > PackedBoard::MAX_CELLS) { return false; }
+		if (header.tupleRecordSize != WEIGHT_FILE_TUPLE_RECORD_SIZE) { return false; }
+		if (header.tuplesOffset + std::uint64_t{ header.tupleCount } * header.tupleRecordSize > header.scalesOffset) { return false; }
+
+		std::uint64_t weightCount = 0;
+		for (size_t t = 0; t < header.tupleCount; ++t)
+		{
+			const auto* record = reinterpret_cast<const std::uint8_t*>(bytes.data() + header.tuplesOffset + t * header.tupleRecordSize);
+			if (record[0] == 0 || record[0] > NTupleLayout::MAX_TUPLE_SIZE) { return false; }
+
+			NTuple_t& tuple = tuples.emplace_back();
+			for (size_t k = 0; k < record[0]; ++k)
+			{
+				if (record[1 + k] >= k_cells) { return false; }
+				tuple.push_back(record[1 + k]);
+			}
+			weightCount += std::uint64_t{ 1 } << (NTupleLayout::BITS_PER_CELL * tuple.size());
+		}
+		return weightCount * header.stageCount == header.weightCount;
+	}
+
+	size_t weightSize(WeightType weightType)
+	{
+		switch (weightType)
+		{
+		case WeightType::Float32:
+			return sizeof(float);
+		case WeightType::Int16:
+			return sizeof(std::int16_t);
+		case WeightType::Int8:
+			return sizeof(std::int8_t);
+		default:
+			return 0;
+		}
+	}
+}
+
+bool writeWeightFile(const std::string& path, const NTupleNetwork& network)
+{
+	const std::vector<float> unitScales(network.getLayout().getStageCount() * network.getLayout().getTuples().size(), 1.0f);
+	return writeSections(path, WeightType::Float32, network.getLayout(), std::span<const float>(unitScales), network.getWeights());
+}
+
+bool writeWeightFile(const std::string& path, const Int16NTupleNetwork& network)
+{
+	return writeSections(path, WeightType::Int16, network.getLayout(), network.getTableScales(), network.getWeights());
+}
+
+bool writeWeightFile(const std::string& path, const Int8NTupleNetwork& network)
+{
+	return writeSections(path, WeightType::Int8, network.getLayout(), network.getTableScales(), network.getWeights());
+}
+
+std::unique_ptr<MappedNTupleNetwork> MappedNTupleNetwork::open(const std::string& path)
+{
+	MappedFile file(path);
+	const std::span<const std::byte> bytes = file.getBytes();
+	if (bytes.size() < sizeof(WeightFileHeader)) { return nullptr; }
+
+	WeightFileHeader header;
+	std::memcpy(&header, bytes.data(), sizeof(header));
+	if (header.magic != WEIGHT_FILE_MAGIC || header.version != WEIGHT_FILE_VERSION) { return nullptr; }
+	if (header.checksum != headerChecksum(header) || header.fileSize != bytes.size()) { return nullptr; }
+
+	const size_t k_weightSize = weightSize(header.weightType);
+	if (k_weightSize == 0 || header.weightsOffset % WEIGHT_FILE_SECTION_ALIGNMENT != 0 || header.scalesOffset % alignof(float) != 0) { return nullptr; }
+	if (header.scalesOffset + std::uint64_t{ header.stageCount } * header.tupleCount * sizeof(float) > header.weightsOffset) { return nullptr; }
+	if (header.weightsOffset + header.weightCount * k_weightSize != header.fileSize) { return nullptr; }
+
+	std::vector<int> stageStarts;
+	std::vector<NTuple_t> tuples;
+	if (!readStages(header, stageStarts) || !readTuples(bytes, header, tuples)) { return nullptr; }
+	return std::unique_ptr<MappedNTupleNetwork>(new MappedNTupleNetwork(std::move(file), header, tuples, stageStarts));
+}
+
+MappedNTupleNetwork::MappedNTupleNetwork(MappedFile file, const WeightFileHeader& header, const std::vector<NTuple_t>& tuples,
+	const std::vector<int>& stageStarts) :
+	m_file(std::move(file)),
+	m_layout(header.boardHeight, header.boardWidth, tuples, stageStarts),
+	m_weightType(header.weightType),
+	m_headerChecksum(header.checksum),
+	m_tableScales(reinterpret_cast<const float*>(m_file.getBytes().data() + header.scalesOffset)),
+	m_weights(m_file.getBytes().data() + header.weightsOffset)
+{}
+
+float MappedNTupleNetwork::evaluate(const PackedBoard& board) const
+{
+	switch (m_weightType)
+	{
+	case WeightType::Int16:
+		return evaluateWeights<std::int16_t>(board);
+	case WeightType::Int8:
+		return evaluateWeights<std::int8_t>(board);
+	default:
+		return evaluateWeights<float>(board);
+	}
+}
+
+const NTupleLayout& MappedNTupleNetwork::getLayout() const
+{
+	return m_layout;
+}
+
+WeightType MappedNTupleNetwork::getWeightType() const
+{
+	return m_weightType;
+}
+
+std::uint64_t MappedNTupleNetwork::getHeaderChecksum() const
+{
+	return m_headerChecksum;
+}
+
+template <typename Weight_t>
+float MappedNTupleNetwork::evaluateWeights(const PackedBoard& board) const
+{
+	const Weight_t* const k_weights = static_cast<const Weight_t*>(m_weights) + m_layout.getStageOffset(board);
+	const float* const k_scales = m_tableScales + m_layout.getStage(board) * m_layout.getTuples().size();
+	float value = 0.0f;
+	for (const NTupleLayout::Feature& feature : m_layout.getFeatures())
+	{
+		value += k_scales[feature.table] * static_cast<float>(k_weights[m_layout.weightIndex(feature, board)]);
+	}
+	return value;
+}
@@ -0,0 +1,78 @@
+#ifndef WEIGHT_FILE_H
+#define WEIGHT_FILE_H
+
+#include "MappedFile.h"
+#include "NTupleNetwork.h"
+#include "PackedBoard.h"
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+
+enum class WeightType : std::uint32_t
+{
+	Float32,
+	Int16,
+	Int8
+};
+
+// Starts every weight file; little-endian, followed by the tuple, scale and weight
+// sections at cache-line aligned offsets so the weights can be used in place.
+// The checksum covers the header only: verifying the weights would read every page.
+struct WeightFileHeader
+{
+	std::array<char, 8> magic {};
+	std::uint32_t version = 0;
+	WeightType weightType = WeightType::Float32;
+	std::uint32_t boardHeight = 0;
+	std::uint32_t boardWidth = 0;
+	std::uint32_t tupleCount = 0;
+	std::uint32_t tupleRecordSize = 0;		// Cell count byte followed by the cells
+	std::uint32_t stageCount = 0;
+	std::uint32_t reserved = 0;
+	std::array<std::uint8_t, 16> stageStarts {};	// Largest exponent that starts stages 1, 2, ...
+	std::uint64_t tuplesOffset = 0;
+	std::uint64_t scalesOffset = 0;			// One float per stage and tuple table, 1 for float weights
+	std::uint64_t weightsOffset = 0;
+	std::uint64_t weightCount = 0;
+	std::uint64_t fileSize = 0;
+	std::uint64_t checksum = 0;				// FNV-1a of the header bytes before this field
+};
+
+// Written to a temporary file and renamed over path, so a reader never maps a half-written file
+bool writeWeightFile(const std::string& path, const NTupleNetwork& network);
+bool writeWeightFile(const std::string& path, const Int16NTupleNetwork& network);
+bool writeWeightFile(const std::string& path, const Int8NTupleNetwork& network);
+
+// Evaluates straight from a mapped weight file: opening costs the header checks,
+// and processes that open the same file share its pages instead of copying them.
+class MappedNTupleNetwork : public PositionEvaluator
+{
+public:
+	static std::unique_ptr<MappedNTupleNetwork> open(const std::string& path);	// nullptr when missing or invalid
+	float evaluate(const PackedBoard& board) const override;
+
+public:
+	const NTupleLayout& getLayout() const;
+	WeightType getWeightType() const;
+	std::uint64_t getHeaderChecksum() const;
+
+private:
+	MappedNTupleNetwork(MappedFile file, const WeightFileHeader& header, const std::vector<NTuple_t>& tuples,
+		const std::vector<int>& stageStarts);
+
+	template <typename Weight_t>
+	float evaluateWeights(const PackedBoard& board) const;
+
+private:
+	const MappedFile m_file;
+	const NTupleLayout m_layout;
+	const WeightType m_weightType;
+	const std::uint64_t m_headerChecksum;
+	const float* const m_tableScales;
+	const void* const m_weights;
+};
+
+#endif // WEIGHT_FILE_H
@@ -0,0 +1,87 @@
+#include "WorkStealing.h"
+
+#include <cassert>
+#include <limits>
+
+namespace
+{
+	constexpr int WORK_BOUND_BITS = 32;
+	constexpr std::uint64_t WORK_BOUND_MASK = (std::uint64_t{ 1 } << WORK_BOUND_BITS) - 1;
+
+	std::uint64_t packBounds(std::uint64_t begin, std::uint64_t end)
+	{
+		return begin | (end << WORK_BOUND_BITS);
+	}
+
+	std::uint64_t getBegin(std::uint64_t bounds)
+	{
+		return bounds & WORK_BOUND_MASK;
+	}
+
+	std::uint64_t getEnd(std::uint64_t bounds)
+	{
+		return bounds >> WORK_BOUND_BITS;
+	}
+}
+
+WorkStealingRanges::WorkStealingRanges(size_t workerCount, size_t chunkCount) :
+	m_shares(workerCount)
+{
+	assert(workerCount > 0 && "Work needs at least one worker");
+	assert(chunkCount <= std::numeric_limits<std::uint32_t>::max() && "Too many chunks to pack");
+
+	for (size_t w = 0; w < workerCount; ++w)
+	{
+		m_shares[w].bounds.store(packBounds(chunkCount * w / workerCount, chunkCount * (w + 1) / workerCount), std::memory_order_relaxed);
+	}
+}
+
+std::optional<size_t> WorkStealingRanges::next(size_t worker)
+{
+	for (;;)
+	{
+		if (const std::optional<size_t> chunk = takeFront(worker)) { return chunk; }
+		if (!stealHalf(worker)) { return std::nullopt; }
+	}
+}
+
+size_t WorkStealingRanges::getStealCount(size_t worker) const
+{
+	return m_shares[worker].steals;
+}
+
+std::optional<size_t> WorkStealingRanges::takeFront(size_t worker)
+{
+	std::atomic<std::uint64_t>& bounds = m_shares[worker].bounds;
+	std::uint64_t current = bounds.load(std::memory_order_acquire);
+	while (getBegin(current) < getEnd(current))
+	{
+		if (bounds.compare_exchange_weak(current, packBounds(getBegin(current) + 1, getEnd(current)), std::memory_order_acq_rel))
+		{
+			return static_cast<size_t>(getBegin(current));
+		}
+	}
+	return std::nullopt;
+}
+
+// The stolen half is cut from the victim before it becomes ours, so no chunk is ever
+// held by two workers; a worker that scans while it is in flight just finds less to steal
+bool WorkStealingRanges::stealHalf(size_t worker)
+{
+	for (size_t offset = 1; offset < m_shares.size(); ++offset)
+	{
+		std::atomic<std::uint64_t>& victim = m_shares[(worker + offset) % m_shares.size()].bounds;
+		std::uint64_t current = victim.load(std::memory_order_acquire);
+		while (getBegin(current) < getEnd(current))
+		{
+			const std::uint64_t k_split = getEnd(current) - (getEnd(current) - getBegin(current) + 1) / 2;
+			if (victim.compare_exchange_weak(current, packBounds(getBegin(current), k_split), std::memory_order_acq_rel))
+			{
+				m_shares[worker].bounds.store(packBounds(k_split, getEnd(current)), std::memory_order_release);
+				++m_shares[worker].steals;
+				return true;
+			}
+		}
+	}
+	return false;
+}
@@ -0,0 +1,39 @@
+#ifndef WORK_STEALING_H
+#define WORK_STEALING_H
+
+#include <atomic>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+// Hands the chunk indices [0, chunkCount) out to a fixed set of workers. Each worker starts
+// with a contiguous share and takes chunks from its front; one that runs dry steals the back
+// half of another's remaining share. A share is packed into one atomic word, so taking and
+// stealing are single compare-exchanges and nobody waits on a lock.
+class WorkStealingRanges
+{
+public:
+	WorkStealingRanges(size_t workerCount, size_t chunkCount);
+
+public:
+	std::optional<size_t> next(size_t worker);		// Empty once no worker has chunks left
+
+public:
+	size_t getStealCount(size_t worker) const;		// Only once the workers have finished
+
+private:
+	std::optional<size_t> takeFront(size_t worker);
+	bool stealHalf(size_t worker);
+
+private:
+	struct alignas(64) Share
+	{
+		std::atomic<std::uint64_t> bounds = 0;		// Begin in the low half, end in the high half
+		size_t steals = 0;							// Written by the owner only
+	};
+
+private:
+	std::vector<Share> m_shares;
+};
+
+#endif // WORK_STEALING_H
@@ -2,16 +2,93 @@
 // 1. Refactor code
 // 2. Add fuzz tests
 
+#include <chrono>
 #include <iostream>
+#include <string>
+#include <thread>
+#include "Benchmark.h"
 #include "Game.h"
+#include "Solver.h"
+#include "TdTrainer.h"
+#include "WeightFile.h"
 
+inline constexpr std::chrono::milliseconds AUTO_PLAY_MOVE_BUDGET { 5 };
+inline constexpr size_t TRAINING_BOARD_HEIGHT = 5;	// Same board as Game
+inline constexpr size_t TRAINING_BOARD_WIDTH = 4;
+inline constexpr int TRAINING_STAGE_START = 11;		// A second set of weights once 2048 is on the board
 
-int main() 
+// Usage: Game2048 [--auto [renderInterval [weightFile]] | --benchmark mcts|training|quantization|incremental|batch|simulation [maxThreads]
+//                  | --train games [threads [weightFile [checkpointFile]]]]
+int main(int argc, char* argv[]) 
 {
+	if (argc > 2 && std::string(argv[1]) == "--train")
+	{
+		NTupleNetwork network(TRAINING_BOARD_HEIGHT, TRAINING_BOARD_WIDTH,
+			NTupleNetwork::defaultTuples(TRAINING_BOARD_HEIGHT, TRAINING_BOARD_WIDTH), { TRAINING_STAGE_START });
+		TdTrainingSettings settings;
+		settings.schedule = LearningRateSchedule::Exponential;
+		settings.threadCount = (argc > 3) ? std::stoul(argv[3]) : std::max(1u, std::thread::hardware_concurrency());
+		settings.checkpointPath = (argc > 5) ? argv[5] : "";
+		const size_t k_games = std::stoul(argv[2]);
+		TdTrainer trainer(network, settings);
+		if (checkpointExists(settings.checkpointPath))
+		{
+			if (!trainer.loadCheckpoint(k_games))
+			{
+				std::cerr << "'" << settings.checkpointPath << "' is not a checkpoint of this run\n";
+				return 1;
+			}
+			std::cout << "Resuming after game " << trainer.getResumedGames() << '\n';
+		}
+		trainer.train(k_games, std::cout);
+		if (!trainer.isCheckpointComplete()) { std::cerr << "Could not write " << settings.checkpointPath << '\n'; }
+		if (argc > 4 && !writeWeightFile(argv[4], network))
+		{
+			std::cerr << "Could not write " << argv[4] << '\n';
+			return 1;
+		}
+		return 0;
+	}
+
+	if (argc > 2 && std::string(argv[1]) == "--benchmark")
+	{
+		const size_t maxThreads = (argc > 3) ? std::stoul(argv[3]) : std::max(1u, std::thread::hardware_concurrency());
+		if (std::string(argv[2]) == "mcts") { runMctsScalingBenchmark(std::cout, maxThreads); }
+		if (std::string(argv[2]) == "training") { runTrainingScalingBenchmark(std::cout, maxThreads); }
+		if (std::string(argv[2]) == "quantization") { runQuantizationBenchmark(std::cout, maxThreads); }
+		if (std::string(argv[2]) == "incremental") { runIncrementalEvaluationBenchmark(std::cout, maxThreads); }
+		if (std::string(argv[2]) == "batch") { runBatchEvaluationBenchmark(std::cout, maxThreads); }
+		if (std::string(argv[2]) == "simulation") { runSimulationScalingBenchmark(std::cout, maxThreads); }
+		return 0;
+	}
+
 	std::ostream& display = std::cout;
 	std::istream& keyboard = std::cin;
 	
 	Game game(display, keyboard);
+
+	if (argc > 1 && std::string(argv[1]) == "--auto")
+	{
+		const size_t renderInterval = (argc > 2) ? std::stoul(argv[2]) : 0;
+		if (argc > 3)
+		{
+			const auto network = MappedNTupleNetwork::open(argv[3]);
+			if (!network || network->getLayout().getBoardHeight() != TRAINING_BOARD_HEIGHT
+				|| network->getLayout().getBoardWidth() != TRAINING_BOARD_WIDTH)
+			{
+				std::cerr << argv[3] << " is not a weight file for this board\n";
+				return 1;
+			}
+			NTuplePolicy policy(*network);
+			game.autoPlay(policy, renderInterval);
+			return 0;
+		}
+
+		ExpectimaxPolicy policy(AUTO_PLAY_MOVE_BUDGET);
+		game.autoPlay(policy, renderInterval);
+		return 0;
+	}
+
 	game.run();
 
 	system("pause");
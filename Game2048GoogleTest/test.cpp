@@ -1,7 +1,36 @@
 #include "pch.h"
 #include "Board.h"
+#include "Checkpoint.h"
+#include "Dataset.h"
+#include "GameRecord.h"
+#include "Histogram.h"
+#include "MctsPolicy.h"
+#include "MonteCarloPolicy.h"
+#include "NTupleNetwork.h"
+#include "PackedBoard.h"
+#include "Policy.h"
+#include "PolicyComparison.h"
+#include "ReplayArchive.h"
+#include "ReplayVerifier.h"
+#include "Simulator.h"
+#include "Solver.h"
+#include "TdTrainer.h"
+#include "WeightFile.h"
+#include "WorkStealing.h"
 #include <tuple>
 #include <span>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <stop_token>
+#include <thread>
+#include <sstream>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <algorithm>
+#include <random>
 
 inline constexpr int GAME_WIN_VALUE = 2048;
 
@@ -150,4 +179,1276 @@ TEST(Game2048, GameVictory)
 	b.move('d');
 	EXPECT_TRUE(b.canMove());
 	EXPECT_TRUE(b.reachedVictoryValue());
-}
\ No newline at end of file
+}
+
+TEST(Game2048, SolverReturnsLegalMoveWithinBudget)
+{
+	Board b(GAME_WIN_VALUE, 4, 4);
+	int position[16] = {
+		2,		4,		8,		16,
+		0,		2,		4,		8,
+		0,		0,		2,		4,
+		0,		0,		0,		2
+	};
+	b.setBoard(position);
+
+	Solver solver;
+	const SearchResult result = solver.findBestMove(b, std::chrono::milliseconds(50));
+	EXPECT_GE(result.depth, 1);
+	EXPECT_TRUE(b.slide(result.direction));
+}
+
+TEST(Game2048, SolverCancelledBeforeFirstIteration)
+{
+	Board b(GAME_WIN_VALUE, 4, 4);
+	int position[16] = {
+		2,		4,		8,		16,
+		4,		8,		16,		32,
+		8,		16,		32,		64,
+		16,		32,		64,		0
+	};
+	b.setBoard(position);
+
+	std::stop_source cancellation;
+	cancellation.request_stop();
+
+	Solver solver;
+	const SearchResult result = solver.findBestMove(b, std::chrono::seconds(1), cancellation.get_token());
+	EXPECT_EQ(result.depth, 0);
+	EXPECT_TRUE(result.isInterrupted);
+	EXPECT_TRUE(b.slide(result.direction));
+}
+
+TEST(Game2048, SolverReportsNoMoveOnLostBoard)
+{
+	Board b(GAME_WIN_VALUE, 4, 4);
+	int failed[16] = {
+		1, 2, 3, 4,
+		5, 6, 7, 8,
+		9, 10, 11, 12,
+		13, 15, 14, 16
+	};
+	b.setBoard(failed);
+
+	Solver solver;
+	const SearchResult result = solver.findBestMove(b, std::chrono::milliseconds(5));
+	EXPECT_EQ(result.direction, 0);
+}
+
+TEST(Game2048, SolverPonderDeepensFollowUpSearch)
+{
+	Board b(GAME_WIN_VALUE, 4, 4);
+	int position[16] = {
+		2,		4,		8,		16,
+		0,		2,		4,		8,
+		0,		0,		2,		4,
+		0,		0,		0,		2
+	};
+	b.setBoard(position);
+
+	// The first follow-up ponder visits: first legal move, small tile in the first empty cell
+	Board followUp = b;
+	for (const char direction : { 'w', 'a', 's', 'd' })
+	{
+		if (followUp.slide(direction)) { break; }
+	}
+	followUp.placeTile(0, 2);
+
+	constexpr int maxDepth = 4;
+	Solver warm(maxDepth);
+	{
+		std::stop_source deadline;
+		std::jthread timer([&deadline](std::stop_token isPondered)
+			{
+				std::mutex mutex;
+				std::condition_variable_any wakeUp;
+				std::unique_lock lock(mutex);
+				wakeUp.wait_for(lock, isPondered, std::chrono::seconds(5), [] { return false; });
+				deadline.request_stop();
+			});
+		warm.ponder(b, deadline.get_token());
+	}
+
+	Solver cold(maxDepth);
+	const auto budget = std::chrono::milliseconds(1);
+	const SearchResult coldResult = cold.findBestMove(followUp, budget);
+	const SearchResult warmResult = warm.findBestMove(followUp, budget);
+	EXPECT_GT(warmResult.depth, coldResult.depth);
+}
+
+TEST(Game2048, SolverInterruptedPonderCachesOnlyFinishedSearches)
+{
+	Board b(GAME_WIN_VALUE, 4, 4);
+	int position[16] = {
+		2,		4,		8,		16,
+		0,		2,		4,		8,
+		0,		0,		2,		4,
+		0,		0,		0,		2
+	};
+	b.setBoard(position);
+
+	std::vector<Board> followUps;
+	for (const char direction : { 'w', 'a', 's', 'd' })
+	{
+		Board afterstate = b;
+		if (!afterstate.slide(direction)) { continue; }
+		for (size_t k = 0; k < afterstate.getEmptyTilesCount(); ++k)
+		{
+			for (const int value : { 2, 4 })
+			{
+				Board followUp = afterstate;
+				followUp.placeTile(k, value);
+				followUps.push_back(followUp);
+			}
+		}
+	}
+
+	Solver interrupted(Solver::DEFAULT_MAX_DEPTH);
+	{
+		std::stop_source interruption;
+		std::jthread timer([&interruption]
+			{
+				std::this_thread::sleep_for(std::chrono::milliseconds(100));
+				interruption.request_stop();
+			});
+		interrupted.ponder(b, interruption.get_token());
+	}
+
+	int deepest = 0;
+	for (const Board& followUp : followUps)
+	{
+		if (const auto cached = interrupted.findCachedValue(followUp)) { deepest = std::max(deepest, cached->depth); }
+	}
+	ASSERT_GT(deepest, 0);
+	ASSERT_LT(deepest, Solver::DEFAULT_MAX_DEPTH - 1);
+
+	// Pondering is deterministic, so a run that finishes the interrupted round must agree
+	// with every follow-up cached at that depth; a partial value from the aborted one would not
+	Solver finished(deepest + 1);
+	finished.ponder(b, {});
+
+	int compared = 0;
+	for (const Board& followUp : followUps)
+	{
+		const auto partial = interrupted.findCachedValue(followUp);
+		const auto complete = finished.findCachedValue(followUp);
+		if (!partial || !complete || partial->depth != deepest || complete->depth != deepest) { continue; }
+
+		EXPECT_EQ(partial->value, complete->value);
+		++compared;
+	}
+	EXPECT_GT(compared, 0);
+}
+
+TEST(Game2048, RandomPolicyOnlyPicksLegalMoves)
+{
+	Board b(GAME_WIN_VALUE, 4, 4);
+	int position[16] = {
+		2,		4,		8,		16,
+		4,		8,		16,		32,
+		8,		16,		32,		64,
+		16,		32,		64,		0
+	};
+	b.setBoard(position);
+
+	RandomPolicy policy(42);
+	for (int i = 0; i < 16; ++i)
+	{
+		const char direction = policy.chooseMove(b);
+		EXPECT_TRUE(direction == 's' || direction == 'd');
+	}
+}
+
+TEST(Game2048, MonteCarloPolicyPicksLegalMoveWithParallelRollouts)
+{
+	Board b(GAME_WIN_VALUE, 4, 4);
+	int position[16] = {
+		2,		4,		8,		16,
+		4,		8,		16,		32,
+		8,		16,		32,		64,
+		16,		32,		64,		0
+	};
+	b.setBoard(position);
+
+	MonteCarloSettings settings;
+	settings.rolloutsPerDecision = 64;
+	settings.threadCount = 2;
+	settings.rolloutPolicy = RolloutPolicy::Greedy;
+
+	MonteCarloPolicy policy(settings);
+	for (std::uint64_t decision = 1; decision <= 3; ++decision)
+	{
+		const char direction = policy.chooseMove(b);
+		EXPECT_TRUE(direction == 's' || direction == 'd');
+		EXPECT_GT(policy.getMovesPlayed(), 64u * decision);
+	}
+}
+
+TEST(Game2048, BoardClearsToEmptyAndConvertsTileExponents)
+{
+	Board b(GAME_WIN_VALUE, 4, 4);
+	int position[16] = {
+		2,		4,		8,		16,
+		4,		8,		16,		32,
+		8,		16,		32,		64,
+		16,		32,		64,		64
+	};
+	b.setBoard(position);
+	b.slide('a');
+	EXPECT_EQ(b.getMaxTile(), 128);
+	EXPECT_GT(b.getScore(), 0);
+
+	b.clear();
+	EXPECT_EQ(b.getMaxTile(), 0);
+	EXPECT_EQ(b.getScore(), 0);
+	EXPECT_EQ(b.getEmptyTilesCount(), 16u);
+	EXPECT_TRUE(b == Board::makeEmpty(GAME_WIN_VALUE, 4, 4));
+
+	for (int exponent = 0; exponent <= PackedBoard::MAX_EXPONENT; ++exponent)
+	{
+		EXPECT_EQ(getTileExponent(getExponentTile(exponent)), exponent);
+	}
+	EXPECT_EQ(getExponentTile(0), 0);
+	EXPECT_EQ(getTileExponent(2048), 11);
+}
+
+TEST(Game2048, NodeArenaHandsOutNodesUntilFullAndResets)
+{
+	NodeArena arena(2);
+	const std::uint32_t first = arena.allocate();
+	const std::uint32_t second = arena.allocate();
+	EXPECT_NE(first, NodeArena::NO_NODE);
+	EXPECT_NE(second, NodeArena::NO_NODE);
+	EXPECT_NE(first, second);
+	EXPECT_EQ(arena.allocate(), NodeArena::NO_NODE);
+
+	arena.reset();
+	EXPECT_EQ(arena.size(), 0u);
+	EXPECT_EQ(arena.allocate(), first);
+
+	// A block is handed out whole or not at all
+	EXPECT_EQ(arena.allocate(2), NodeArena::NO_NODE);
+	arena.reset();
+	EXPECT_EQ(arena.allocate(2), first);
+	EXPECT_EQ(arena.allocate(), NodeArena::NO_NODE);
+}
+
+TEST(Game2048, MctsPolicyPicksLegalMove)
+{
+	Board b(GAME_WIN_VALUE, 4, 4);
+	int position[16] = {
+		2,		4,		8,		16,
+		4,		8,		16,		32,
+		8,		16,		32,		64,
+		16,		32,		64,		0
+	};
+	b.setBoard(position);
+
+	MctsSettings settings;
+	settings.iterationsPerDecision = 200;
+	settings.arenaCapacity = 4096;
+
+	MctsPolicy policy(settings);
+	const char direction = policy.chooseMove(b);
+	EXPECT_TRUE(direction == 's' || direction == 'd');
+	EXPECT_EQ(policy.getIterations(), 200u);
+}
+
+TEST(Game2048, MctsPolicyReseedRepeatsSearch)
+{
+	Board b(GAME_WIN_VALUE, 4, 4);
+	int position[16] = {
+		2,		4,		8,		16,
+		0,		2,		4,		8,
+		0,		0,		2,		4,
+		0,		0,		0,		2
+	};
+	b.setBoard(position);
+
+	MctsSettings settings;
+	settings.iterationsPerDecision = 300;
+	settings.arenaCapacity = 1 << 14;
+	settings.seed = 1;
+	MctsPolicy first(settings);
+	settings.seed = 2;
+	MctsPolicy second(settings);
+
+	first.chooseMove(b);
+	second.chooseMove(b);
+	first.newGame();
+	second.newGame();
+	first.reseed(7);
+	second.reseed(7);
+
+	const char direction = first.chooseMove(b);
+	EXPECT_EQ(second.chooseMove(b), direction);
+	EXPECT_EQ(second.getNodeCount(), first.getNodeCount());
+}
+
+TEST(Game2048, MctsPolicyKeepsSubtreeWhenArenaFills)
+{
+	Board b(GAME_WIN_VALUE, 4, 4);
+	int position[16] = {
+		2,		4,		8,		16,
+		0,		2,		4,		8,
+		0,		0,		2,		4,
+		0,		0,		0,		2
+	};
+	b.setBoard(position);
+
+	MctsSettings settings;
+	settings.iterationsPerDecision = 800;
+	settings.arenaCapacity = 2048;
+	MctsPolicy policy(settings);
+
+	const char direction = policy.chooseMove(b);
+	ASSERT_TRUE(b.slide(direction));
+	ASSERT_GT(policy.getNodeCount(), settings.arenaCapacity / 2);
+
+	b.placeTile(0, 2);
+	EXPECT_TRUE(b.slide(policy.chooseMove(b)));
+	EXPECT_GT(policy.getRootVisits(), settings.iterationsPerDecision);
+	EXPECT_LE(policy.getNodeCount(), settings.arenaCapacity);
+}
+
+namespace
+{
+	// Counted decisions on several threads: every iteration backs up through the root exactly once
+	void checkParallelMcts(MctsParallelism parallelism)
+	{
+		Board b(GAME_WIN_VALUE, 4, 4);
+		int position[16] = {
+			2,		4,		8,		16,
+			0,		2,		4,		8,
+			0,		0,		2,		4,
+			0,		0,		0,		2
+		};
+		b.setBoard(position);
+
+		MctsSettings settings;
+		settings.iterationsPerDecision = 3000;
+		settings.arenaCapacity = 1 << 16;
+		settings.threadCount = 3;
+		settings.parallelism = parallelism;
+		MctsPolicy policy(settings);
+
+		const char first = policy.chooseMove(b);
+		ASSERT_TRUE(b.slide(first));
+		EXPECT_EQ(policy.getIterations(), settings.iterationsPerDecision);
+		EXPECT_EQ(policy.getReusedRootVisits(), 0u);
+		EXPECT_EQ(policy.getRootVisits(), settings.iterationsPerDecision);
+
+		b.placeTile(0, 2);
+		const char second = policy.chooseMove(b);
+		EXPECT_TRUE(b.slide(second));
+		EXPECT_EQ(policy.getIterations(), 2 * settings.iterationsPerDecision);
+		EXPECT_GT(policy.getReusedRootVisits(), 0u);
+		EXPECT_EQ(policy.getRootVisits(), policy.getReusedRootVisits() + settings.iterationsPerDecision);
+	}
+}
+
+TEST(Game2048, MctsTreeParallelSearchCountsEveryIteration)
+{
+	checkParallelMcts(MctsParallelism::Tree);
+}
+
+TEST(Game2048, MctsRootParallelSearchCountsEveryIteration)
+{
+	checkParallelMcts(MctsParallelism::Root);
+}
+
+TEST(Game2048, PackedBoardRoundTripsTileExponents)
+{
+	Board b(GAME_WIN_VALUE, 5, 4);
+	int position[20] = {
+		2,		4,		8,		16,
+		0,		0,		32,		0,
+		0,		64,		0,		0,
+		0,		0,		0,		128,
+		65536,	0,		0,		2048
+	};
+	b.setBoard(position);
+
+	const PackedBoard packed = packBoard(b);
+	EXPECT_EQ(packed.getExponent(0), 1);
+	EXPECT_EQ(packed.getExponent(6), 5);
+	EXPECT_EQ(packed.getExponent(15), 7);
+	EXPECT_EQ(packed.getExponent(16), PackedBoard::MAX_EXPONENT);
+	EXPECT_EQ(packed.getExponent(19), 11);
+	EXPECT_EQ(packed.getExponent(4), 0);
+}
+
+TEST(Game2048, NTupleNetworkScoresMirroredBoardsEqually)
+{
+	int position[16] = {
+		2,		4,		8,		16,
+		0,		0,		32,		0,
+		0,		64,		0,		0,
+		2,		0,		0,		128
+	};
+	int mirrored[16] = {
+		16,		8,		4,		2,
+		0,		32,		0,		0,
+		0,		0,		64,		0,
+		128,	0,		0,		2
+	};
+	Board b(GAME_WIN_VALUE, 4, 4);
+	b.setBoard(position);
+	Board m(GAME_WIN_VALUE, 4, 4);
+	m.setBoard(mirrored);
+
+	NTupleNetwork network(4, 4, { { 0, 1, 2, 3 }, { 0, 1, 4, 5 } });
+	EXPECT_EQ(network.getFeatureCount(), 16u);
+	EXPECT_EQ(network.evaluate(b), 0.0f);
+
+	network.update(packBoard(b), 0.5f);
+	EXPECT_GT(network.evaluate(b), 0.0f);
+	EXPECT_EQ(network.evaluate(b), network.evaluate(m));
+}
+
+TEST(Game2048, NTupleDefaultTuplesFitTheBoard)
+{
+	for (const auto& [height, width] : { std::pair<size_t, size_t>{ 4, 4 }, { 5, 4 }, { 3, 3 }, { 6, 5 } })
+	{
+		const std::vector<NTuple_t> tuples = NTupleNetwork::defaultTuples(height, width);
+		EXPECT_FALSE(tuples.empty());
+		for (const NTuple_t& tuple : tuples)
+		{
+			EXPECT_LE(tuple.size(), NTupleNetwork::MAX_TUPLE_SIZE);
+			for (const size_t cell : tuple) { EXPECT_LT(cell, height * width); }
+		}
+	}
+}
+
+TEST(Game2048, TdTrainerImprovesGreedyPlay)
+{
+	NTupleNetwork network(4, 4, { { 0, 1, 2, 3 }, { 4, 5, 6, 7 }, { 0, 1, 4, 5 } });
+	TdTrainingSettings settings;
+	settings.evaluationInterval = 0;
+	settings.lambda = 0.5f;
+
+	TdTrainer trainer(network, settings);
+	const TrainingEvaluation before = trainer.evaluate(50);
+	std::ostringstream log;
+	trainer.train(500, log);
+	const TrainingEvaluation after = trainer.evaluate(50);
+
+	EXPECT_EQ(trainer.getGamesPlayed(), 500u);
+	EXPECT_GT(after.meanScore, before.meanScore);
+	EXPECT_TRUE(log.str().empty());
+}
+
+TEST(Game2048, TdTrainerSharesWeightsAcrossThreads)
+{
+	NTupleNetwork network(4, 4, { { 0, 1, 2, 3 }, { 4, 5, 6, 7 }, { 0, 1, 4, 5 } });
+	TdTrainingSettings settings;
+	settings.evaluationInterval = 50;
+	settings.evaluationGames = 10;
+	settings.threadCount = 3;
+
+	TdTrainer trainer(network, settings);
+	std::ostringstream log;
+	const TrainingEvaluation last = trainer.train(200, log);
+
+	EXPECT_EQ(trainer.getGamesPlayed(), 200u);
+	EXPECT_EQ(last.gamesTrained, 200u);
+	EXPECT_GT(last.meanScore, 0.0);
+	EXPECT_NE(log.str().find("games"), std::string::npos);
+}
+
+TEST(Game2048, QuantizedNTupleNetworkTracksFloatValues)
+{
+	NTupleNetwork network(4, 4, { { 0, 1, 2, 3 }, { 0, 1, 4, 5 } });
+	TdTrainingSettings settings;
+	settings.evaluationInterval = 0;
+	TdTrainer(network, settings).train(100, std::cout);
+
+	const Int16NTupleNetwork int16Network(network);
+	const Int8NTupleNetwork int8Network(network);
+	Board b(GAME_WIN_VALUE, 4, 4);
+	for (int move = 0; move < 20 && b.canMove(); ++move)
+	{
+		const PackedBoard packed = packBoard(b);
+		const float value = network.evaluate(packed);
+		EXPECT_NEAR(int16Network.evaluate(packed), value, 0.001f * std::abs(value) + 1.0f);
+		EXPECT_NEAR(int8Network.evaluate(packed), value, 0.05f * std::abs(value) + 1.0f);
+		for (const char direction : { 'a', 's', 'd', 'w' })
+		{
+			if (b.move(direction)) { break; }
+		}
+	}
+}
+
+TEST(Game2048, WeightFileMapsBackToTheSameValues)
+{
+	NTupleNetwork network(5, 4, { { 0, 1, 2, 3 }, { 0, 1, 4, 5 } }, { 6 });
+	TdTrainingSettings settings;
+	settings.evaluationInterval = 0;
+	TdTrainer(network, settings).train(50, std::cout);
+	const Int8NTupleNetwork int8Network(network);
+
+	const std::string floatPath = "weights_float.bin";
+	const std::string int8Path = "weights_int8.bin";
+	ASSERT_TRUE(writeWeightFile(floatPath, network));
+	ASSERT_TRUE(writeWeightFile(int8Path, int8Network));
+	{
+		const auto mappedFloat = MappedNTupleNetwork::open(floatPath);
+		const auto mappedInt8 = MappedNTupleNetwork::open(int8Path);
+		ASSERT_TRUE(mappedFloat && mappedInt8);
+		EXPECT_EQ(mappedInt8->getWeightType(), WeightType::Int8);
+		EXPECT_EQ(mappedFloat->getLayout().getBoardHeight(), 5u);
+		EXPECT_EQ(mappedFloat->getLayout().getStageStarts(), std::vector<int>{ 6 });
+
+		Board b(GAME_WIN_VALUE, 5, 4);
+		for (int move = 0; move < 20 && b.canMove(); ++move)
+		{
+			const PackedBoard packed = packBoard(b);
+			EXPECT_EQ(mappedFloat->evaluate(packed), network.evaluate(packed));
+			EXPECT_EQ(mappedInt8->evaluate(packed), int8Network.evaluate(packed));
+			for (const char direction : { 'a', 's', 'd', 'w' })
+			{
+				if (b.move(direction)) { break; }
+			}
+		}
+	}
+
+	// A flipped header byte fails the checksum
+	{
+		std::fstream file(floatPath, std::ios::binary | std::ios::in | std::ios::out);
+		file.seekp(offsetof(WeightFileHeader, boardWidth));
+		file.put(5);
+	}
+	EXPECT_EQ(MappedNTupleNetwork::open(floatPath), nullptr);
+	EXPECT_EQ(MappedNTupleNetwork::open("missing_weights.bin"), nullptr);
+
+	std::remove(floatPath.c_str());
+	std::remove(int8Path.c_str());
+}
+
+TEST(Game2048, BoardReportsCellsChangedBySlideAndSpawn)
+{
+	int position[20] = {
+		2,		0,		0,		0,
+		0,		0,		0,		0,
+		2,		4,		8,		16,
+		0,		4,		0,		0,
+		0,		0,		0,		0
+	};
+	Board b(GAME_WIN_VALUE, 5, 4);
+	b.setBoard(position);
+
+	ASSERT_TRUE(b.slide('d'));
+	EXPECT_EQ(b.getChangedCells(), std::uint64_t{ 0xF00F });
+
+	const size_t cell = b.placeTile(0, 2);
+	EXPECT_EQ(b.getChangedCells(), std::uint64_t{ 0xF00F } | (std::uint64_t{ 1 } << cell));
+
+	// A new slide starts a new record; the full third row does not move
+	ASSERT_TRUE(b.slide('a'));
+	EXPECT_EQ(b.getChangedCells(), std::uint64_t{ 0xF00F });
+}
+
+TEST(Game2048, NTupleIncrementalEvaluationMatchesFullEvaluation)
+{
+	NTupleNetwork network(5, 4, { { 0, 1, 2, 3 }, { 0, 1, 4, 5 }, { 4, 5, 6, 7 } });
+	TdTrainingSettings settings;
+	settings.evaluationInterval = 0;
+	TdTrainer(network, settings).train(50, std::cout);
+
+	NTupleContributions parent;
+	Board b(GAME_WIN_VALUE, 5, 4);
+	Board successor = b;
+	for (int move = 0; move < 30 && b.canMove(); ++move)
+	{
+		network.collectContributions(packBoard(b), parent);
+		EXPECT_FLOAT_EQ(parent.total, network.evaluate(b));
+		for (const char direction : { 'w', 'a', 's', 'd' })
+		{
+			successor = b;
+			if (!successor.slide(direction)) { continue; }
+			if (successor.getEmptyTilesCount() > 0) { successor.placeTile(0, 4); }
+
+			const PackedBoard packed = packBoard(successor);
+			EXPECT_NEAR(network.evaluateChanged(packed, parent, successor.getChangedCells()), network.evaluate(packed), 0.01f);
+		}
+		for (const char direction : { 'a', 's', 'd', 'w' })
+		{
+			if (b.move(direction)) { break; }
+		}
+	}
+}
+
+TEST(Game2048, NTupleStagesKeepSeparateWeights)
+{
+	int early[16] = {
+		2,		4,		8,		16,
+		0,		0,		0,		0,
+		0,		0,		0,		0,
+		0,		0,		0,		0
+	};
+	int late[16] = {
+		2,		4,		8,		64,
+		0,		0,		0,		0,
+		0,		0,		0,		0,
+		0,		0,		0,		0
+	};
+	Board b(GAME_WIN_VALUE, 4, 4);
+	b.setBoard(early);
+	Board l(GAME_WIN_VALUE, 4, 4);
+	l.setBoard(late);
+
+	NTupleNetwork staged(4, 4, { { 0, 1, 2 } }, { 6 });
+	NTupleNetwork single(4, 4, { { 0, 1, 2 } });
+	EXPECT_EQ(staged.getWeightCount(), 2 * single.getWeightCount());
+
+	staged.update(packBoard(b), 1.0f);
+	single.update(packBoard(b), 1.0f);
+	EXPECT_GT(staged.evaluate(b), 0.0f);
+	EXPECT_EQ(staged.evaluate(l), 0.0f);
+	EXPECT_GT(single.evaluate(l), 0.0f);
+}
+
+TEST(Game2048, TdTrainerFillsLateStagesFromKeptPositions)
+{
+	NTupleNetwork network(4, 4, { { 0, 1, 2, 3 }, { 0, 1, 4, 5 } }, { 8 });
+	TdTrainingSettings settings;
+	settings.evaluationInterval = 0;
+	settings.stagePoolSize = 16;
+
+	TdTrainer trainer(network, settings);
+	trainer.train(300, std::cout);
+
+	// Some weight of the second stage, which only boards with a 256 tile read, has been trained
+	const std::span<const float> weights = network.getWeights();
+	const auto lateStage = weights.subspan(network.getLayout().getStageWeightCount());
+	EXPECT_TRUE(std::any_of(lateStage.begin(), lateStage.end(), [](float weight) { return weight != 0.0f; }));
+}
+
+TEST(Game2048, BatchMatchesSingleEvaluation)
+{
+	NTupleNetwork network(5, 4, NTupleNetwork::defaultTuples(5, 4), { 7 });
+	TdTrainingSettings settings;
+	settings.evaluationInterval = 0;
+	TdTrainer(network, settings).train(100, std::cout);
+	const Int8NTupleNetwork int8Network(network);
+
+	// Eleven boards: one full batch of lanes and a short one, with both stages present
+	std::vector<PackedBoard> boards;
+	Board board(GAME_WIN_VALUE, 5, 4);
+	std::mt19937_64 generator(11);
+	board.spawnTile(generator());
+	while (boards.size() < 11)
+	{
+		for (const char direction : { 'a', 's', 'd', 'w' })
+		{
+			if (board.slide(direction))
+			{
+				board.spawnTile(generator());
+				break;
+			}
+		}
+		boards.push_back(packBoard(board));
+	}
+	boards[10].setExponent(19, 8);
+
+	std::vector<float> values(boards.size());
+	network.evaluateBatch(boards, values);
+	for (size_t k = 0; k < boards.size(); ++k) { EXPECT_FLOAT_EQ(values[k], network.evaluate(boards[k])); }
+
+	int8Network.evaluateBatch(boards, values);
+	for (size_t k = 0; k < boards.size(); ++k)
+	{
+		const float single = int8Network.evaluate(boards[k]);
+		EXPECT_NEAR(values[k], single, 1e-4f * std::max(1.0f, std::abs(single)));
+	}
+}
+
+TEST(Game2048, SimulatorIsReproducible)
+{
+	SimulationSettings settings;
+	settings.games = 20;
+	settings.boardHeight = 4;
+	settings.boardWidth = 4;
+	settings.seed = 7;
+	const PolicyFactory makePolicy = [](std::uint64_t seed) { return std::make_unique<RandomPolicy>(seed); };
+
+	const SimulationResult first = Simulator(settings, makePolicy).run();
+	const SimulationResult second = Simulator(settings, makePolicy).run();
+	EXPECT_EQ(first.games, 20u);
+	EXPECT_GT(first.moves, first.games);
+	EXPECT_EQ(first.moves, second.moves);
+	EXPECT_EQ(first.scoreSum, second.scoreSum);
+	EXPECT_GE(first.maxTile, 2 * 2 * 2);
+	EXPECT_EQ(first.winRate(settings.winValue), 0.0);
+	EXPECT_EQ(first.scores.getCount(), 20u);
+	EXPECT_EQ(first.maxTiles.getMax(), static_cast<std::uint64_t>(first.maxTile));
+}
+
+TEST(Game2048, SimulatorResultDoesNotDependOnThreads)
+{
+	SimulationSettings settings;
+	settings.games = 40;
+	settings.seed = 5;
+	settings.pinThreads = false;
+	// Untrained weights: plays the largest merge, a deterministic policy
+	const NTupleNetwork network(5, 4, { { 0, 1, 2, 3 } });
+	const PolicyFactory makePolicy = [&network](std::uint64_t) { return std::make_unique<NTuplePolicy>(network); };
+
+	const SimulationResult single = Simulator(settings, makePolicy).run();
+	settings.threadCount = 3;
+	const SimulationResult parallel = Simulator(settings, makePolicy).run();
+	EXPECT_EQ(parallel.games, single.games);
+	EXPECT_EQ(parallel.moves, single.moves);
+	EXPECT_EQ(parallel.scoreSum, single.scoreSum);
+	EXPECT_EQ(parallel.maxTile, single.maxTile);
+}
+
+TEST(Game2048, WorkStealingHandsOutEveryChunkOnce)
+{
+	// A lone worker drains its own share, then steals the back half of what is left elsewhere
+	WorkStealingRanges lone(2, 10);
+	std::vector<size_t> order;
+	for (std::optional<size_t> chunk = lone.next(0); chunk; chunk = lone.next(0)) { order.push_back(*chunk); }
+	EXPECT_EQ(order, (std::vector<size_t>{ 0, 1, 2, 3, 4, 7, 8, 9, 6, 5 }));
+	EXPECT_EQ(lone.getStealCount(0), 3u);
+
+	constexpr size_t k_workers = 4;
+	constexpr size_t k_chunks = 5000;
+	WorkStealingRanges shared(k_workers, k_chunks);
+	std::vector<std::vector<size_t>> taken(k_workers);
+	{
+		std::vector<std::jthread> threads;
+		for (size_t w = 0; w < k_workers; ++w)
+		{
+			threads.emplace_back([&shared, &taken, w]
+			{
+				for (std::optional<size_t> chunk = shared.next(w); chunk; chunk = shared.next(w)) { taken[w].push_back(*chunk); }
+			});
+		}
+	}
+	std::vector<size_t> all;
+	for (const std::vector<size_t>& chunks : taken) { all.insert(all.end(), chunks.begin(), chunks.end()); }
+	std::sort(all.begin(), all.end());
+	ASSERT_EQ(all.size(), k_chunks);
+	for (size_t k = 0; k < k_chunks; ++k) { EXPECT_EQ(all[k], k); }
+}
+
+TEST(Game2048, HistogramPercentilesAndMerge)
+{
+	Histogram low;
+	Histogram high;
+	for (std::uint64_t value = 1; value <= 1000; ++value) { (value <= 500 ? low : high).record(value); }
+	low.merge(high);
+
+	EXPECT_EQ(low.getCount(), 1000u);
+	EXPECT_EQ(low.getMax(), 1000u);
+	EXPECT_EQ(low.percentile(0.0), 1u);
+	EXPECT_EQ(low.percentile(1.0), 10u);		// Exact below 32
+	for (const double percent : { 50.0, 90.0, 99.0, 99.9 })
+	{
+		const auto k_exact = static_cast<double>(std::ceil(percent * 10.0));
+		EXPECT_LE(static_cast<double>(low.percentile(percent)), k_exact);
+		EXPECT_GE(static_cast<double>(low.percentile(percent)), k_exact * (1.0 - 1.0 / Histogram::SUB_BUCKETS));
+	}
+
+	// Tiles are powers of two, which start buckets, so counts against them are exact
+	Histogram tiles;
+	for (const std::uint64_t tile : { 512, 1024, 2048, 2048, 4096 }) { tiles.record(tile); }
+	EXPECT_EQ(tiles.countAtLeast(2048), 3u);
+	EXPECT_EQ(tiles.percentile(50.0), 2048u);
+}
+
+TEST(Game2048, GameRecordsReplayToTheirScores)
+{
+	const std::string path = "game_record_test.rec";
+	SimulationSettings settings;
+	settings.games = 12;
+	settings.threadCount = 2;
+	settings.pinThreads = false;
+	settings.chunkSize = 5;
+	settings.seed = 3;
+	settings.recordPath = path;
+	const SimulationResult result = Simulator(settings, [](std::uint64_t seed) { return std::make_unique<RandomPolicy>(seed); }).run();
+
+	std::vector<std::uint64_t> games;
+	std::uint64_t turns = 0;
+	for (size_t t = 0; t < settings.threadCount; ++t)
+	{
+		const std::string shardPath = getRecordShardPath(path, t);
+		GameRecordReader reader(shardPath);
+		ASSERT_TRUE(reader.isOpen());
+		EXPECT_EQ(reader.getHeader().bytesPerTurn, 1u);
+		EXPECT_EQ(reader.getHeader().seed, settings.seed);
+
+		GameRecord record;
+		while (reader.next(record))
+		{
+			Board board = Board::makeEmpty(settings.winValue, settings.boardHeight, settings.boardWidth);
+			for (const RecordedSpawn& spawn : record.openingSpawns) { board.setTile(spawn.cell / 4, spawn.cell % 4, spawn.tile); }
+			for (const RecordedTurn& turn : record.turns)
+			{
+				ASSERT_TRUE(board.slide(turn.direction));
+				ASSERT_EQ(board.getTile(turn.spawn.cell / 4, turn.spawn.cell % 4), 0);
+				board.setTile(turn.spawn.cell / 4, turn.spawn.cell % 4, turn.spawn.tile);
+			}
+			EXPECT_FALSE(board.canMove());
+			EXPECT_EQ(board.getScore(), record.finalScore);
+			games.push_back(record.game);
+			turns += record.turns.size();
+		}
+		std::remove(shardPath.c_str());
+	}
+
+	std::sort(games.begin(), games.end());
+	EXPECT_EQ(games.size(), settings.games);
+	EXPECT_EQ(games.back(), settings.games - 1);
+	EXPECT_EQ(turns, result.moves);
+}
+
+TEST(Game2048, ReplayArchiveSeeksMatchSequentialReplay)
+{
+	const std::string path = "replay_archive_test.rec";
+	SimulationSettings settings;
+	settings.games = 6;
+	settings.pinThreads = false;
+	settings.seed = 5;
+	settings.recordPath = path;
+	Simulator(settings, [](std::uint64_t seed) { return std::make_unique<RandomPolicy>(seed); }).run();
+	const std::string shardPath = getRecordShardPath(path, 0);
+	const std::string indexPath = shardPath + ".idx";
+
+	constexpr size_t k_interval = 8;
+	for (int pass = 0; pass < 2; ++pass)
+	{
+		// The first pass builds the index and writes it, the second maps the written one
+		const std::unique_ptr<ReplayArchive> archive = ReplayArchive::open(shardPath, k_interval);
+		ASSERT_NE(archive, nullptr);
+		EXPECT_TRUE(std::ifstream(indexPath).good());
+		EXPECT_FALSE(std::filesystem::exists(indexPath + ".tmp"));
+		ASSERT_EQ(archive->getEntries().size(), settings.games);
+		EXPECT_FALSE(archive->findGame(settings.games).has_value());
+
+		GameRecord record;
+		for (std::uint64_t game = 0; game < settings.games; ++game)
+		{
+			const std::optional<size_t> entry = archive->findGame(game);
+			ASSERT_TRUE(entry.has_value());
+			ASSERT_TRUE(archive->readGame(*entry, record));
+			EXPECT_EQ(record.game, game);
+
+			Board board = archive->makeEmptyBoard();
+			Board seek = archive->makeEmptyBoard();
+			for (const RecordedSpawn& spawn : record.openingSpawns) { board.setTile(spawn.cell / 4, spawn.cell % 4, spawn.tile); }
+			for (size_t turn = 0; turn <= record.turns.size(); ++turn)
+			{
+				ASSERT_TRUE(archive->loadPosition(*entry, turn, seek));
+				ASSERT_EQ(seek, board);
+				ASSERT_EQ(seek.getScore(), board.getScore());
+				if (turn == record.turns.size()) { break; }
+
+				board.slide(record.turns[turn].direction);
+				board.setTile(record.turns[turn].spawn.cell / 4, record.turns[turn].spawn.cell % 4, record.turns[turn].spawn.tile);
+			}
+			EXPECT_EQ(board.getScore(), record.finalScore);
+			EXPECT_FALSE(archive->loadPosition(*entry, record.turns.size() + 1, seek));
+		}
+	}
+	std::remove(shardPath.c_str());
+	std::remove(indexPath.c_str());
+}
+
+TEST(Game2048, ReplayVerifierFlagsFirstDivergence)
+{
+	const std::string path = "replay_verifier_test.rec";
+	SimulationSettings settings;
+	settings.games = 150;
+	settings.pinThreads = false;
+	settings.seed = 9;
+	settings.recordPath = path;
+	const SimulationResult simulation = Simulator(settings, [](std::uint64_t seed) { return std::make_unique<RandomPolicy>(seed); }).run();
+	const std::string shardPath = getRecordShardPath(path, 0);
+
+	{
+		const std::unique_ptr<ReplayArchive> archive = ReplayArchive::open(shardPath);
+		ASSERT_NE(archive, nullptr);
+		const ReplayVerification verification = verifyReplays(*archive, 3);
+		EXPECT_EQ(verification.games, settings.games);
+		EXPECT_EQ(verification.moves, simulation.moves);
+		EXPECT_TRUE(verification.divergences.empty());
+
+		GameRecord record;
+		ASSERT_TRUE(archive->readGame(*archive->findGame(4), record));
+		Board board = archive->makeEmptyBoard();
+		ASSERT_FALSE(verifyReplay(record, board).has_value());
+
+		GameRecord tampered = record;
+		tampered.finalScore += 4;
+		board = archive->makeEmptyBoard();
+		std::optional<ReplayDivergence> divergence = verifyReplay(tampered, board);
+		ASSERT_TRUE(divergence.has_value());
+		EXPECT_EQ(divergence->game, 4u);
+		EXPECT_EQ(divergence->turn, record.turns.size());
+		EXPECT_EQ(divergence->kind, ReplayDivergenceKind::WrongScore);
+
+		tampered = record;
+		tampered.turns.resize(3);
+		board = archive->makeEmptyBoard();
+		divergence = verifyReplay(tampered, board);
+		ASSERT_TRUE(divergence.has_value());
+		EXPECT_EQ(divergence->kind, ReplayDivergenceKind::UnfinishedGame);
+
+		tampered = record;
+		tampered.openingSpawns[1].cell = tampered.openingSpawns[0].cell;
+		board = archive->makeEmptyBoard();
+		divergence = verifyReplay(tampered, board);
+		ASSERT_TRUE(divergence.has_value());
+		EXPECT_EQ(divergence->turn, 0u);
+		EXPECT_EQ(divergence->kind, ReplayDivergenceKind::OccupiedSpawn);
+
+		// Both openings sit packed in the top-left corner, so sliding left moves nothing
+		tampered.game = 7;
+		tampered.openingSpawns = { RecordedSpawn{ 0, 2 }, RecordedSpawn{ 1, 4 } };
+		tampered.turns = { RecordedTurn{ 'a', RecordedSpawn{ 5, 2 } } };
+		board = archive->makeEmptyBoard();
+		divergence = verifyReplay(tampered, board);
+		ASSERT_TRUE(divergence.has_value());
+		EXPECT_EQ(divergence->game, 7u);
+		EXPECT_EQ(divergence->turn, 0u);
+		EXPECT_EQ(divergence->kind, ReplayDivergenceKind::IllegalMove);
+	}
+	std::remove(shardPath.c_str());
+	std::remove((shardPath + ".idx").c_str());
+}
+
+TEST(Game2048, DatasetHoldsEveryMoveOfEveryGame)
+{
+	const std::string path = "dataset_test.set";
+	SimulationSettings settings;
+	settings.games = 20;
+	settings.threadCount = 2;
+	settings.pinThreads = false;
+	settings.chunkSize = 3;
+	settings.seed = 11;
+	settings.datasetPath = path;
+	Simulator simulator(settings, [](std::uint64_t seed) { return std::make_unique<RandomPolicy>(seed); });
+	const SimulationResult result = simulator.run();
+
+	std::uint64_t rows = 0;
+	std::uint64_t terminals = 0;
+	std::uint64_t rewardSum = 0;
+	for (size_t t = 0; t < settings.threadCount; ++t)
+	{
+		EXPECT_TRUE(simulator.getWorkerReports()[t].isDatasetComplete);
+		const std::string shardPath = getRecordShardPath(path, t);
+		DatasetReader reader(shardPath);
+		ASSERT_TRUE(reader.isOpen());
+		ASSERT_EQ(reader.getHeader().stateWords, 2u);
+
+		DatasetBlock block;
+		while (reader.next(block))
+		{
+			ASSERT_EQ(block.states.size(), 2 * block.getRowCount());
+			ASSERT_EQ(block.terminals.back(), 1);
+			for (size_t row = 0; row < block.getRowCount(); ++row)
+			{
+				EXPECT_LT(block.actions[row], 4);
+				EXPECT_GE(block.rewards[row], 0);
+				rewardSum += static_cast<std::uint64_t>(block.rewards[row]);
+				terminals += block.terminals[row];
+
+				// Within a game, each move starts where the previous one left the board
+				if (row + 1 < block.getRowCount() && !block.terminals[row])
+				{
+					EXPECT_EQ(block.nextStates[2 * row], block.states[2 * (row + 1)]);
+					EXPECT_EQ(block.nextStates[2 * row + 1], block.states[2 * (row + 1) + 1]);
+				}
+			}
+			rows += block.getRowCount();
+		}
+		std::remove(shardPath.c_str());
+	}
+
+	EXPECT_EQ(rows, result.moves);
+	EXPECT_EQ(terminals, result.games);
+	EXPECT_EQ(rewardSum, result.scoreSum);
+}
+
+TEST(Game2048, DatasetColumnsStartAlignedForOddRowCounts)
+{
+	const std::string path = "dataset_alignment_test.set";
+	Board board = Board::makeEmpty(GAME_WIN_VALUE, 4, 4);
+	board.setTile(0, 0, 2);
+	const PackedBoard k_state = packBoard(board);
+	{
+		DatasetWriter writer(path, makeDatasetFileHeader(4, 4, 3));
+		ASSERT_TRUE(writer.isOpen());
+		for (int row = 0; row < 3; ++row) { writer.addMove(k_state, 'd', row, k_state); }
+		writer.endGame();
+		ASSERT_TRUE(writer.close());
+	}
+
+	std::ifstream file(path, std::ios::binary);
+	std::vector<char> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	ASSERT_GE(bytes.size(), sizeof(DatasetFileHeader) + sizeof(DatasetBlockHeader));
+	DatasetBlockHeader header;
+	std::memcpy(&header, bytes.data() + sizeof(DatasetFileHeader), sizeof(header));
+	EXPECT_EQ(header.rowCount, 3u);
+	EXPECT_EQ(sizeof(DatasetFileHeader) + header.blockBytes, bytes.size());
+	for (const std::uint32_t offset : header.columnOffsets) { EXPECT_EQ((sizeof(DatasetFileHeader) + offset) % 8, 0u); }
+
+	// Columns are where the header says, so they can be read in place
+	std::int32_t lastReward = 0;
+	std::memcpy(&lastReward, bytes.data() + sizeof(DatasetFileHeader) + header.columnOffsets[DATASET_REWARDS] + 2 * sizeof(std::int32_t), sizeof(lastReward));
+	EXPECT_EQ(lastReward, 2);
+	EXPECT_EQ(bytes[sizeof(DatasetFileHeader) + header.columnOffsets[DATASET_ACTIONS]], 3);
+	EXPECT_EQ(bytes[sizeof(DatasetFileHeader) + header.columnOffsets[DATASET_TERMINALS] + 2], 1);
+
+	DatasetReader reader(path);
+	DatasetBlock block;
+	ASSERT_TRUE(reader.next(block));
+	EXPECT_EQ(block.getRowCount(), 3u);
+	EXPECT_EQ(block.states.front(), k_state.nibbles[0]);
+	EXPECT_EQ(block.terminals, (std::vector<std::uint8_t>{ 0, 0, 1 }));
+	EXPECT_FALSE(reader.next(block));
+	std::remove(path.c_str());
+}
+
+TEST(Game2048, CheckpointWriterReplacesOnlyOnCommit)
+{
+	const std::string path = "checkpoint_writer_test.ckp";
+	const std::vector<float> weights(100000, 0.5f);
+	{
+		CheckpointWriter checkpoint(path, CheckpointKind::Training);
+		checkpoint.write(std::uint64_t{ 7 });
+		checkpoint.writeBytes(weights.data(), weights.size() * sizeof(float));
+		checkpoint.writeString("generator");
+		ASSERT_TRUE(checkpoint.commit());
+	}
+	EXPECT_FALSE(checkpointExists(path + ".tmp"));
+
+	// An abandoned writer leaves the committed checkpoint as it was
+	{
+		CheckpointWriter checkpoint(path, CheckpointKind::Training);
+		checkpoint.write(std::uint64_t{ 8 });
+	}
+	EXPECT_FALSE(checkpointExists(path + ".tmp"));
+
+	CheckpointReader checkpoint(path, CheckpointKind::Training);
+	ASSERT_TRUE(checkpoint.isOpen());
+	std::uint64_t value = 0;
+	std::vector<float> loaded(weights.size());
+	std::string text;
+	EXPECT_TRUE(checkpoint.read(value));
+	EXPECT_EQ(value, 7u);
+	EXPECT_TRUE(checkpoint.readBytes(loaded.data(), loaded.size() * sizeof(float)));
+	EXPECT_EQ(loaded, weights);
+	EXPECT_TRUE(checkpoint.readString(text));
+	EXPECT_EQ(text, "generator");
+	EXPECT_TRUE(checkpoint.isAtEnd());
+	EXPECT_FALSE(CheckpointReader(path, CheckpointKind::Simulation).isOpen());
+
+	// A torn file fails its size or checksum check as a whole
+	std::filesystem::resize_file(path, std::filesystem::file_size(path) - 1);
+	EXPECT_FALSE(CheckpointReader(path, CheckpointKind::Training).isOpen());
+	std::remove(path.c_str());
+}
+
+TEST(Game2048, SimulatorResumesFromCheckpoint)
+{
+	const std::string path = "simulator_checkpoint_test.ckp";
+	SimulationSettings settings;
+	settings.games = 50;
+	settings.threadCount = 2;
+	settings.pinThreads = false;
+	settings.chunkSize = 4;
+	settings.seed = 13;
+	const PolicyFactory makePolicy = [](std::uint64_t seed) { return std::make_unique<RandomPolicy>(seed); };
+	const SimulationResult uninterrupted = Simulator(settings, makePolicy).run();
+
+	// A stop requested up front ends the run at its first checkpoint
+	settings.checkpointPath = path;
+	settings.checkpointInterval = 20;
+	std::stop_source stop;
+	stop.request_stop();
+	EXPECT_EQ(Simulator(settings, makePolicy).run(stop.get_token()).games, 20u);
+
+	Simulator resumed(settings, makePolicy);
+	ASSERT_TRUE(resumed.loadCheckpoint());
+	EXPECT_EQ(resumed.getResumedGames(), 20u);
+	const SimulationResult result = resumed.run();
+	EXPECT_TRUE(resumed.isCheckpointComplete());
+	EXPECT_EQ(result.games, uninterrupted.games);
+	EXPECT_EQ(result.moves, uninterrupted.moves);
+	EXPECT_EQ(result.scoreSum, uninterrupted.scoreSum);
+	EXPECT_EQ(result.maxScore, uninterrupted.maxScore);
+	EXPECT_EQ(result.maxTile, uninterrupted.maxTile);
+	EXPECT_TRUE(result.scores == uninterrupted.scores);
+	EXPECT_TRUE(result.gameLengths == uninterrupted.gameLengths);
+	EXPECT_TRUE(result.maxTiles == uninterrupted.maxTiles);
+
+	settings.seed = 14;
+	EXPECT_FALSE(Simulator(settings, makePolicy).loadCheckpoint());
+	std::remove(path.c_str());
+}
+
+TEST(Game2048, SimulatorRefusesCheckpointOfOtherPolicy)
+{
+	const std::string path = "simulator_policy_checkpoint_test.ckp";
+	SimulationSettings settings;
+	settings.games = 20;
+	settings.pinThreads = false;
+	settings.seed = 13;
+	settings.checkpointPath = path;
+	settings.checkpointInterval = 10;
+	settings.policyIdentity = "random";
+	const PolicyFactory makeRandom = [](std::uint64_t seed) { return std::make_unique<RandomPolicy>(seed); };
+	std::stop_source stop;
+	stop.request_stop();
+	EXPECT_EQ(Simulator(settings, makeRandom).run(stop.get_token()).games, 10u);
+
+	settings.policyIdentity = "montecarlo rollouts=100";
+	const PolicyFactory makeMonteCarlo = [](std::uint64_t seed)
+	{
+		MonteCarloSettings monteCarlo;
+		monteCarlo.rolloutsPerDecision = 100;
+		monteCarlo.seed = seed;
+		return std::make_unique<MonteCarloPolicy>(monteCarlo);
+	};
+	EXPECT_FALSE(Simulator(settings, makeMonteCarlo).loadCheckpoint());
+
+	settings.policyIdentity = "random";
+	Simulator resumed(settings, makeRandom);
+	EXPECT_TRUE(resumed.loadCheckpoint());
+	EXPECT_EQ(resumed.getResumedGames(), 10u);
+	std::remove(path.c_str());
+}
+
+TEST(Game2048, TdTrainerResumesFromCheckpoint)
+{
+	const std::string path = "trainer_checkpoint_test.ckp";
+	const std::vector<NTuple_t> tuples = { { 0, 1, 2, 3 }, { 4, 5, 6, 7 }, { 0, 1, 4, 5 } };
+	TdTrainingSettings settings;
+	settings.evaluationInterval = 10;
+	settings.evaluationGames = 5;
+	settings.schedule = LearningRateSchedule::Linear;
+	settings.stagePoolSize = 20;
+	settings.seed = 21;
+	std::ostringstream log;
+
+	NTupleNetwork uninterrupted(4, 4, tuples, { 6 });
+	const TrainingEvaluation expected = TdTrainer(uninterrupted, settings).train(60, log);
+
+	settings.checkpointPath = path;
+	settings.checkpointInterval = 25;
+	NTupleNetwork interrupted(4, 4, tuples, { 6 });
+	std::stop_source stop;
+	stop.request_stop();
+	TdTrainer first(interrupted, settings);
+	first.train(60, log, stop.get_token());
+	EXPECT_EQ(first.getGamesPlayed(), 25u);
+
+	// The same weight count laid out over other cells or stages is another run
+	NTupleNetwork otherCells(4, 4, { { 0, 1, 2, 3 }, { 8, 9, 10, 11 }, { 0, 1, 4, 5 } }, { 6 });
+	EXPECT_EQ(otherCells.getWeightCount(), interrupted.getWeightCount());
+	EXPECT_FALSE(TdTrainer(otherCells, settings).loadCheckpoint(60));
+	NTupleNetwork otherStages(4, 4, tuples, { 7 });
+	EXPECT_FALSE(TdTrainer(otherStages, settings).loadCheckpoint(60));
+
+	NTupleNetwork resumed(4, 4, tuples, { 6 });
+	TdTrainer second(resumed, settings);
+	EXPECT_FALSE(second.loadCheckpoint(61));
+	ASSERT_TRUE(second.loadCheckpoint(60));
+	EXPECT_EQ(second.getResumedGames(), 25u);
+	const TrainingEvaluation last = second.train(60, log);
+
+	EXPECT_EQ(second.getGamesPlayed(), 60u);
+	EXPECT_TRUE(std::equal(resumed.getWeights().begin(), resumed.getWeights().end(), uninterrupted.getWeights().begin(), uninterrupted.getWeights().end()));
+	EXPECT_EQ(last.meanScore, expected.meanScore);
+	EXPECT_EQ(last.maxScore, expected.maxScore);
+	std::remove(path.c_str());
+}
+
+namespace
+{
+	// Keeps the big tiles in the bottom-left corner: down, then left, right, up
+	class CornerPolicy : public Policy
+	{
+	public:
+		char chooseMove(const Board& board) override
+		{
+			if (!m_scratch) { m_scratch.emplace(board); }
+			for (const char direction : { 's', 'a', 'd', 'w' })
+			{
+				*m_scratch = board;
+				if (m_scratch->slide(direction)) { return direction; }
+			}
+			return 0;
+		}
+
+	private:
+		std::optional<Board> m_scratch;
+	};
+}
+
+TEST(Game2048, PolicyComparisonPairsGamesOnSharedSpawns)
+{
+	ComparisonSettings settings;
+	settings.maxGames = 2000;
+	settings.minGames = 100;
+	settings.gamesPerLook = 100;
+	settings.boardHeight = 4;
+	settings.seed = 5;
+	const PolicyFactory makeCorner = [](std::uint64_t) { return std::make_unique<CornerPolicy>(); };
+	const PolicyFactory makeRandom = [](std::uint64_t seed) { return std::make_unique<RandomPolicy>(seed); };
+
+	const ComparisonResult corner = PolicyComparison(settings, makeCorner, makeRandom).run();
+	EXPECT_TRUE(corner.isSignificant);
+	EXPECT_GT(corner.meanDifference, 0.0);
+	EXPECT_GT(corner.intervalLow, 0.0);
+	EXPECT_LT(corner.games, settings.maxGames);
+	EXPECT_EQ(corner.games % settings.gamesPerLook, 0u);
+
+	settings.threadCount = 3;
+	const ComparisonResult threaded = PolicyComparison(settings, makeCorner, makeRandom).run();
+	EXPECT_EQ(threaded.games, corner.games);
+	EXPECT_EQ(threaded.meanDifference, corner.meanDifference);
+	EXPECT_EQ(threaded.standardError, corner.standardError);
+
+	// Identical policies reseeded per game play identical games, so every pair ties
+	settings.maxGames = 300;
+	const ComparisonResult same = PolicyComparison(settings, makeRandom, makeRandom).run();
+	EXPECT_FALSE(same.isSignificant);
+	EXPECT_EQ(same.games, settings.maxGames);
+	EXPECT_EQ(same.looks, 3u);
+	EXPECT_EQ(same.meanDifference, 0.0);
+	EXPECT_EQ(same.standardError, 0.0);
+	EXPECT_GT(same.meanScoreA, 0.0);
+}
+
+TEST(Game2048, ComparisonSumsAreExactInAnyOrder)
+{
+	WideSum wide;
+	wide.add(~std::uint64_t{ 0 });
+	wide.add(2);
+	EXPECT_EQ(wide.high, 1u);
+	EXPECT_EQ(wide.low, 1u);
+
+	// Squares this large carry a double sum past 2^53 within a few games
+	const std::vector<std::pair<int, int>> k_pairs = { { 2000000001, 3 }, { 1999999999, 1000000007 }, { 7, 2147483647 }, { 1234567891, 1234567890 },
+		{ 2147483647, 5 }, { 2000000003, 11 }, { 2147483646, 13 } };
+	ComparisonSums forward;
+	for (const auto& [a, b] : k_pairs) { forward.add(a, b); }
+	ComparisonSums first;
+	ComparisonSums second;
+	for (size_t k = 0; k < k_pairs.size(); ++k) { (k % 2 ? first : second).add(k_pairs[k].first, k_pairs[k].second); }
+	second.merge(first);
+
+	EXPECT_EQ(forward.squareSumA.high, 1u);
+	EXPECT_EQ(second.scoreSumA, forward.scoreSumA);
+	EXPECT_EQ(second.differenceSum, forward.differenceSum);
+	EXPECT_EQ(second.squareSumA.low, forward.squareSumA.low);
+	EXPECT_EQ(second.squareSumA.high, forward.squareSumA.high);
+	EXPECT_EQ(second.differenceSquareSum.low, forward.differenceSquareSum.low);
+	EXPECT_EQ(second.differenceSquareSum.high, forward.differenceSquareSum.high);
+	EXPECT_EQ(forward.squareSumB.toDouble(), std::ldexp(1.0, 64) * forward.squareSumB.high + forward.squareSumB.low);
+}
@@ -0,0 +1,319 @@
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <string>
+#include <thread>
+#include "MonteCarloPolicy.h"
+#include "NTupleNetwork.h"
+#include "Policy.h"
+#include "PolicyComparison.h"
+#include "ReplayArchive.h"
+#include "ReplayVerifier.h"
+#include "Simulator.h"
+#include "Solver.h"
+#include "WeightFile.h"
+
+inline constexpr std::chrono::microseconds SIMULATOR_EXPECTIMAX_BUDGET { 1000 };
+inline constexpr size_t SIMULATOR_MONTE_CARLO_ROLLOUTS = 100;
+inline constexpr double SIMULATOR_PERCENTILES[] = { 50.0, 90.0, 99.0, 99.9 };
+inline constexpr size_t SIMULATOR_SHOWN_DIVERGENCES = 10;
+
+namespace
+{
+	void printUsage(std::ostream& output)
+	{
+		output << "Usage: Game2048Simulator [--games n] [--policy random|montecarlo|expectimax|ntuple]\n"
+			<< "                        [--height h] [--width w] [--win value] [--seed s] [--weights file]\n"
+			<< "                        [--threads t] [--pin 0|1] [--chunk games] [--record path]\n"
+			<< "                        [--dataset path] [--checkpoint path] [--checkpoint-every games]\n"
+			<< "       Game2048Simulator --replay path --game n [--turn m]\n"
+			<< "       Game2048Simulator --verify path [--threads t]\n"
+			<< "       Game2048Simulator --policy a --compare b [--compare-weights file] [--games max]\n"
+			<< "                        [--min-games n] [--look games] [--confidence c]\n";
+	}
+
+	void printPercentiles(std::ostream& output, const char* name, const Histogram& histogram)
+	{
+		output << std::setw(12) << name;
+		for (const double percent : SIMULATOR_PERCENTILES) { output << std::setw(10) << histogram.percentile(percent); }
+		output << histogram.getMax() << '\n';
+	}
+
+	void printResult(std::ostream& output, const SimulationResult& result, int winValue)
+	{
+		output << std::left << std::fixed << std::setprecision(2)
+			<< std::setw(12) << "games" << result.games << '\n'
+			<< std::setw(12) << "moves" << result.moves << '\n'
+			<< std::setw(12) << "seconds" << result.seconds << '\n'
+			<< std::setw(12) << "games/s" << result.gamesPerSecond() << '\n'
+			<< std::setw(12) << "moves/s" << result.movesPerSecond() << '\n'
+			<< std::setw(12) << "mean score" << result.meanScore() << '\n'
+			<< std::setw(12) << "max score" << result.maxScore << '\n'
+			<< std::setw(12) << "max tile" << result.maxTile << '\n'
+			<< std::setw(12) << "win rate" << 100.0 * result.winRate(winValue) << "%\n";
+
+		output << '\n' << std::setw(12) << "";
+		for (const char* label : { "p50", "p90", "p99", "p99.9" }) { output << std::setw(10) << label; }
+		output << "max\n";
+		printPercentiles(output, "score", result.scores);
+		printPercentiles(output, "moves", result.gameLengths);
+		printPercentiles(output, "max tile", result.maxTiles);
+	}
+
+	// Prints one position of a recorded game; without a turn, the final one
+	int printReplayPosition(const std::string& recordPath, std::uint64_t game, std::optional<size_t> turn)
+	{
+		const std::unique_ptr<ReplayArchive> archive = ReplayArchive::open(recordPath);
+		if (!archive)
+		{
+			std::cerr << "'" << recordPath << "' is not a record file\n";
+			return 1;
+		}
+
+		const std::optional<size_t> entry = archive->findGame(game);
+		Board board = archive->makeEmptyBoard();
+		if (!entry || !archive->loadPosition(*entry, turn.value_or(archive->getEntries()[*entry].turnCount), board))
+		{
+			std::cerr << "No such game or turn in '" << recordPath << "'\n";
+			return 1;
+		}
+		board.display(std::cout);
+		std::cout << "score " << board.getScore() << '\n';
+		return 0;
+	}
+
+	// Checks every shard the simulator wrote for path, from path.0 up to the first missing one
+	int verifyRecordShards(const std::string& recordPath, size_t threadCount)
+	{
+		ReplayVerification total;
+		size_t shards = 0;
+		for (std::unique_ptr<ReplayArchive> archive = ReplayArchive::open(getRecordShardPath(recordPath, shards)); archive;
+			archive = ReplayArchive::open(getRecordShardPath(recordPath, ++shards)))
+		{
+			ReplayVerification verification = verifyReplays(*archive, threadCount);
+			total.games += verification.games;
+			total.moves += verification.moves;
+			total.seconds += verification.seconds;
+			for (const ReplayDivergence& divergence : verification.divergences)
+			{
+				if (total.divergences.size() < SIMULATOR_SHOWN_DIVERGENCES)
+				{
+					std::cout << getRecordShardPath(recordPath, shards) << ": game " << divergence.game << ", turn "
+						<< divergence.turn << ": " << getDivergenceName(divergence.kind) << '\n';
+				}
+				total.divergences.push_back(divergence);
+			}
+		}
+		if (shards == 0)
+		{
+			std::cerr << "'" << getRecordShardPath(recordPath, 0) << "' is not a record file\n";
+			return 1;
+		}
+
+		std::cout << std::left << std::fixed << std::setprecision(2)
+			<< std::setw(12) << "shards" << shards << '\n'
+			<< std::setw(12) << "games" << total.games << '\n'
+			<< std::setw(12) << "moves" << total.moves << '\n'
+			<< std::setw(12) << "seconds" << total.seconds << '\n'
+			<< std::setw(12) << "moves/s" << total.movesPerSecond() << '\n'
+			<< std::setw(12) << "divergent" << total.divergences.size() << '\n';
+		return total.divergences.empty() ? 0 : 1;
+	}
+
+	// Empty, with the reason printed, when the name is unknown or the weights do not fit the
+	// board; network holds the weights an ntuple policy reads
+	PolicyFactory makePolicyFactory(const std::string& name, const std::string& weightFile, const SimulationSettings& settings,
+		std::unique_ptr<MappedNTupleNetwork>& network)
+	{
+		if (name == "random")
+		{
+			return [](std::uint64_t seed) { return std::make_unique<RandomPolicy>(seed); };
+		}
+		if (name == "montecarlo")
+		{
+			return [](std::uint64_t seed)
+			{
+				MonteCarloSettings monteCarlo;
+				monteCarlo.rolloutsPerDecision = SIMULATOR_MONTE_CARLO_ROLLOUTS;
+				monteCarlo.seed = seed;
+				return std::make_unique<MonteCarloPolicy>(monteCarlo);
+			};
+		}
+		if (name == "expectimax")
+		{
+			return [](std::uint64_t) { return std::make_unique<ExpectimaxPolicy>(SIMULATOR_EXPECTIMAX_BUDGET); };
+		}
+		if (name == "ntuple")
+		{
+			network = MappedNTupleNetwork::open(weightFile);
+			if (!network || network->getLayout().getBoardHeight() != static_cast<size_t>(settings.boardHeight)
+				|| network->getLayout().getBoardWidth() != static_cast<size_t>(settings.boardWidth))
+			{
+				std::cerr << "'" << weightFile << "' is not a weight file for this board\n";
+				return {};
+			}
+			return [weights = network.get()](std::uint64_t) { return std::make_unique<NTuplePolicy>(*weights); };
+		}
+		printUsage(std::cerr);
+		return {};
+	}
+
+	// What a checkpoint must match besides the settings: the policy and the constants it plays with.
+	// A weight file is told apart by its header, which changes with its layout but not its weights.
+	std::string makePolicyIdentity(const std::string& name, const MappedNTupleNetwork* network)
+	{
+		if (name == "montecarlo") { return name + " rollouts=" + std::to_string(SIMULATOR_MONTE_CARLO_ROLLOUTS); }
+		if (name == "expectimax")
+		{
+			return name + " budget=" + std::to_string(SIMULATOR_EXPECTIMAX_BUDGET.count()) + "us depth=" + std::to_string(Solver::DEFAULT_MAX_DEPTH);
+		}
+		if (name == "ntuple" && network) { return name + " weights=" + std::to_string(network->getHeaderChecksum()); }
+		return name;
+	}
+
+	void printComparison(std::ostream& output, const ComparisonResult& result, double confidence)
+	{
+		output << std::left << std::fixed << std::setprecision(2)
+			<< std::setw(12) << "games" << result.games << " per policy in " << result.looks << " looks\n"
+			<< std::setw(12) << "seconds" << result.seconds << '\n'
+			<< std::setw(12) << "mean A" << result.meanScoreA << '\n'
+			<< std::setw(12) << "mean B" << result.meanScoreB << '\n'
+			<< std::setw(12) << "A - B" << result.meanDifference << " +- " << result.standardError << " (standard error)\n"
+			<< std::setw(12) << "interval" << '[' << result.intervalLow << ", " << result.intervalHigh << "] at "
+			<< 100.0 * confidence << "% over all looks\n"
+			<< std::setw(12) << "pairing" << result.varianceReduction << "x fewer games than unpaired runs\n"
+			<< std::setw(12) << "verdict" << (!result.isSignificant ? "no significant difference"
+				: (result.meanDifference > 0.0 ? "A scores higher" : "B scores higher")) << '\n';
+	}
+
+	// Idle time is what the slowest worker's tail cost the others
+	void printWorkerReports(std::ostream& output, const std::vector<SimulationWorkerReport>& reports)
+	{
+		output << '\n' << std::setw(8) << "worker" << std::setw(12) << "games" << std::setw(8) << "steals"
+			<< std::setw(12) << "busy s" << "idle s\n";
+		for (size_t t = 0; t < reports.size(); ++t)
+		{
+			output << std::setw(8) << t << std::setw(12) << reports[t].games << std::setw(8) << reports[t].steals
+				<< std::setw(12) << reports[t].busySeconds << reports[t].idleSeconds << '\n';
+		}
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	SimulationSettings settings;
+	settings.threadCount = std::max(1u, std::thread::hardware_concurrency());
+	std::string policyName = "random";
+	std::string weightFile;
+	std::string replayPath;
+	std::uint64_t replayGame = 0;
+	std::optional<size_t> replayTurn;
+	std::string verifyPath;
+	std::string comparePolicyName;
+	std::string compareWeightFile;
+	ComparisonSettings comparison;
+	for (int arg = 1; arg + 1 < argc; arg += 2)
+	{
+		const std::string option = argv[arg];
+		const std::string value = argv[arg + 1];
+		if (option == "--games") { settings.games = std::stoull(value); }
+		else if (option == "--policy") { policyName = value; }
+		else if (option == "--height") { settings.boardHeight = std::stoi(value); }
+		else if (option == "--width") { settings.boardWidth = std::stoi(value); }
+		else if (option == "--win") { settings.winValue = std::stoi(value); }
+		else if (option == "--seed") { settings.seed = std::stoull(value); }
+		else if (option == "--weights") { weightFile = value; }
+		else if (option == "--threads") { settings.threadCount = std::stoull(value); }
+		else if (option == "--pin") { settings.pinThreads = (value != "0"); }
+		else if (option == "--record") { settings.recordPath = value; }
+		else if (option == "--dataset") { settings.datasetPath = value; }
+		else if (option == "--checkpoint") { settings.checkpointPath = value; }
+		else if (option == "--checkpoint-every") { settings.checkpointInterval = std::stoull(value); }
+		else if (option == "--replay") { replayPath = value; }
+		else if (option == "--game") { replayGame = std::stoull(value); }
+		else if (option == "--turn") { replayTurn = std::stoull(value); }
+		else if (option == "--verify") { verifyPath = value; }
+		else if (option == "--compare") { comparePolicyName = value; }
+		else if (option == "--compare-weights") { compareWeightFile = value; }
+		else if (option == "--min-games") { comparison.minGames = std::stoull(value); }
+		else if (option == "--look") { comparison.gamesPerLook = std::max<size_t>(std::stoull(value), 1); }
+		else if (option == "--confidence") { comparison.confidence = std::stod(value); }
+		else if (option == "--chunk") { settings.chunkSize = std::max<size_t>(std::stoull(value), 1); }
+		else
+		{
+			printUsage(std::cerr);
+			return 1;
+		}
+	}
+	if (argc % 2 == 0)
+	{
+		printUsage(std::cerr);
+		return 1;
+	}
+	if (!replayPath.empty()) { return printReplayPosition(replayPath, replayGame, replayTurn); }
+	if (!verifyPath.empty()) { return verifyRecordShards(verifyPath, settings.threadCount); }
+
+	std::unique_ptr<MappedNTupleNetwork> network;
+	const PolicyFactory makePolicy = makePolicyFactory(policyName, weightFile, settings, network);
+	if (!makePolicy) { return 1; }
+	settings.policyIdentity = makePolicyIdentity(policyName, network.get());
+	if (!comparePolicyName.empty())
+	{
+		std::unique_ptr<MappedNTupleNetwork> compareNetwork;
+		const PolicyFactory makeComparePolicy = makePolicyFactory(comparePolicyName,
+			compareWeightFile.empty() ? weightFile : compareWeightFile, settings, compareNetwork);
+		if (!makeComparePolicy) { return 1; }
+
+		comparison.maxGames = settings.games;
+		comparison.boardHeight = settings.boardHeight;
+		comparison.boardWidth = settings.boardWidth;
+		comparison.winValue = settings.winValue;
+		comparison.seed = settings.seed;
+		comparison.threadCount = settings.threadCount;
+		comparison.chunkSize = settings.chunkSize;
+		printComparison(std::cout, PolicyComparison(comparison, makePolicy, makeComparePolicy).run(), comparison.confidence);
+		return 0;
+	}
+
+	if (!settings.checkpointPath.empty() && !(settings.recordPath.empty() && settings.datasetPath.empty()))
+	{
+		std::cerr << "Checkpointed runs cannot write records or datasets\n";
+		return 1;
+	}
+
+	Simulator simulator(settings, makePolicy);
+	if (checkpointExists(settings.checkpointPath))
+	{
+		if (!simulator.loadCheckpoint())
+		{
+			std::cerr << "'" << settings.checkpointPath << "' is not a checkpoint of this run\n";
+			return 1;
+		}
+		std::cout << "Resuming after game " << simulator.getResumedGames() << '\n';
+	}
+	printResult(std::cout, simulator.run(), settings.winValue);
+	if (settings.threadCount > 1) { printWorkerReports(std::cout, simulator.getWorkerReports()); }
+
+	if (!simulator.isCheckpointComplete())
+	{
+		std::cerr << "Could not write " << settings.checkpointPath << '\n';
+		return 1;
+	}
+	for (size_t t = 0; t < simulator.getWorkerReports().size(); ++t)
+	{
+		if (!simulator.getWorkerReports()[t].isRecordComplete)
+		{
+			std::cerr << "Could not write " << getRecordShardPath(settings.recordPath, t) << '\n';
+			return 1;
+		}
+		if (!simulator.getWorkerReports()[t].isDatasetComplete)
+		{
+			std::cerr << "Could not write " << getRecordShardPath(settings.datasetPath, t) << '\n';
+			return 1;
+		}
+	}
+	return 0;
+}